@@ -1,6 +1,19 @@
 #ifndef ASM_LINKAGE_H
 #define ASM_LINKAGE_H
 
+/* num field of a frame built by sysenter_entry, such a frame may go back
+ * with sysexit */
+#define SYSENTER_FRAME  0x81
+
+/* the pcb sits at the bottom of the KSTACK_SIZE aligned kernel stack, with
+ * its signal sets first, so the trap return path can test them without a
+ * call. signal.c checks these against the C layout. */
+#define KSTACK_MASK         0xFFFFE000
+#define PCB_SIG_PENDING     0
+#define PCB_SIG_BLOCKED     4
+/* offset of the saved cs in the trap frame (sig_regs) */
+#define FRAME_CS            52
+
 #ifndef ASM
     #include "types.h"
     #include "do_syscall.h"
@@ -11,8 +24,10 @@
     extern void pit_interrupt_savereg();        // work for pit interrupt
     extern void mouse_interrupt_savereg();      // work for mouse interrupt
     extern void syscall_dispatch();
+    extern void sysenter_entry();
     extern void jump_to_execute_return(uint32_t status, int32_t parent_esp, int32_t parent_ebp);
     extern void jump_to_next_process(uint32_t next_esp, uint32_t next_ebp);
+    extern void fork_child_return();
 
     extern void Divide_Error();
     extern void Debug_handler();
@@ -1,5 +1,7 @@
 #include "lib.h"
 #include "vga_design.h"
+#include "cursor_graphic.h"
+#include "ktimer.h"
 
 
 
@@ -50,3 +52,31 @@ void graphic_cursor_init()
     graphic_cursor_update(0, 32);
 }
 
+
+static ktimer_t blink_timer;
+static int32_t blink_on = 1;
+
+/* graphic_cursor_blink
+ * flip the cursor at the current screen position and wait another half
+ * period, runs from the timer wheel
+ */
+static void graphic_cursor_blink(uint32_t data)
+{
+    int32_t x, y;
+    get_screen_pos(&x, &y);
+    blink_on = !blink_on;
+    if(blink_on)
+        graphic_cursor_update(x, y);
+    else
+        graphic_cursor_clear(x, y);
+    add_timer(&blink_timer, blink_timer.expires + ms_to_ticks(CURSOR_BLINK_MS));
+}
+
+/* graphic_cursor_blink_start
+ * start blinking the cursor, once at boot
+ */
+void graphic_cursor_blink_start()
+{
+    init_timer(&blink_timer, graphic_cursor_blink, 0);
+    add_timer(&blink_timer, timer_ticks + ms_to_ticks(CURSOR_BLINK_MS));
+}
@@ -2,12 +2,17 @@
 #define CURSOR_GRAPHIC
 
 #include "lib.h"
+
+/* the cursor is drawn for half of this and cleared for the other half */
+#define CURSOR_BLINK_MS 500
+
 void graphic_cursor_update(int32_t x, int32_t y);
 void graphic_cursor_init();
 void graphic_cursor_update_force(int32_t x, int32_t y);
 
 void graphic_cursor_clear_force(int32_t x, int32_t y);
 void graphic_cursor_clear(int32_t x, int32_t y);
+void graphic_cursor_blink_start();
 
 
 #endif
@@ -7,6 +7,8 @@
 
 #define MASK_ALL    0xFF
 
+volatile uint32_t irq_count[NUM_IRQ];
+
 /* Interrupt masks to determine which interrupts are enabled and disabled */
 // uint8_t master_mask = MASK_ALL; /* IRQs 0-7  */
 // uint8_t slave_mask = MASK_ALL;  /* IRQs 8-15 */
@@ -139,6 +141,7 @@ void disable_irq(uint32_t irq_num) {
  */
 void send_eoi(uint32_t irq_num) {
     uint8_t eoi_signal = EOI;
+    irq_count[irq_num]++;
     /* if it is on the master pic */
     if (irq_num < I8259_TOTAL_IRQ) {
         eoi_signal |= irq_num;
@@ -156,3 +159,16 @@ void send_eoi(uint32_t irq_num) {
     }
 }
 
+/*
+ * irq_pending
+ *   DESCRIPTION: Check the master PIC's request register, an irq raised
+ *                while interrupts are off waits there until they are on.
+ *   INPUTS: irq_num -- the IRQ to check, 0-7 on the master PIC
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if the irq is waiting to be delivered, 0 otherwise
+ *   SIDE EFFECTS: the command port reads the IRR until the next OCW3
+ */
+int32_t irq_pending(uint32_t irq_num) {
+    outb(READ_IRR, MASTER_8259_CMD);
+    return (inb(MASTER_8259_CMD) >> irq_num) & 1;
+}
@@ -38,6 +38,13 @@ uint8_t slave_mask;  /* IRQs 8-15 */
  * the interrupt number and sent out to the PIC
  * to declare the interrupt finished */
 #define EOI                 0x60
+/* OCW3 to read the interrupt request register from the command port */
+#define READ_IRR            0x0A
+
+#define NUM_IRQ             (I8259_TOTAL_IRQ * 2)
+
+/* interrupts taken per irq, counted at the EOI every handler sends */
+extern volatile uint32_t irq_count[NUM_IRQ];
 
 /* Externally-visible functions */
 
@@ -49,5 +56,7 @@ void enable_irq(uint32_t irq_num);
 void disable_irq(uint32_t irq_num);
 /* Send end-of-interrupt signal for the specified IRQ */
 void send_eoi(uint32_t irq_num);
+/* Check whether a master PIC irq is raised but not yet delivered */
+int32_t irq_pending(uint32_t irq_num);
 
 #endif /* _I8259_H */
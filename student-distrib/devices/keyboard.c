@@ -6,9 +6,11 @@
 #include "../page.h"
 #include "../data/desktop.h"
 #include "../process_crtl.h"
+#include "../futex.h"
 #include "cursor.h"
 #include "../vga_design.h"
 #include "../signal.h"
+#include "../softirq.h"
 // static helper
 // static void force_putc(unsigned char keyboard_value);
 
@@ -37,6 +39,14 @@ char keyboard_buffer_3[MAX_BUFFER_SIZE];
 backtrace_buffer history_buffer_list[MAX_HISTORY_BUFFER];
 history_element history_key;
 
+// scancodes the interrupt took off the controller, for keyboard_softirq
+static volatile uint8_t scancode_queue[SCANCODE_QUEUE_SIZE];
+static volatile uint32_t scancode_head = 0;
+static volatile uint32_t scancode_tail = 0;
+
+static void keyboard_softirq(void);
+static void keyboard_process(uint8_t keyboard_input);
+
 /*
  * init_keyboard
  *   DESCRIPTION: Initialize the 8259 keyboard interrupt. The entry is 1.
@@ -47,25 +57,63 @@ history_element history_key;
  */
 void init_keyboard()
 {
+    open_softirq(SOFTIRQ_KEYBOARD, keyboard_softirq);
     enable_irq(KEYBOARD_NUMBER);
 }
  
 /*
- * keyboard_handler (for cp2)
- *   DESCRIPTION: Keyboard handler, it will not print the value of functional keys.
+ * keyboard_handler
+ *   DESCRIPTION: Keyboard interrupt, only queue the scancode for
+ *                keyboard_softirq
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: Display all the useful chars on the screen, without left/right/up/down arrow and keypad.
+ *   SIDE EFFECTS: drops the scancode if the queue is full
  */
 void keyboard_handler()
 {
-    uint8_t keyboard_input;             // index for keyboard input in scancode array
-    unsigned char keyboard_value;       // fill the corresponding value in keyboard scancode array
+    uint8_t keyboard_input;
 
     send_eoi(KEYBOARD_NUMBER);          //send end of interrupt message to PIC
 
     keyboard_input = inb(KEYBOARD_DATA_PORT) & HIGH_EIGHT_MASK; //receive the index from keyboard input
+    if (scancode_head - scancode_tail < SCANCODE_QUEUE_SIZE){
+        scancode_queue[scancode_head & SCANCODE_QUEUE_MASK] = keyboard_input;
+        scancode_head++;
+    }
+    raise_softirq(SOFTIRQ_KEYBOARD);
+}
+
+/*
+ * keyboard_softirq
+ *   DESCRIPTION: SOFTIRQ_KEYBOARD handler, process the queued scancodes in
+ *                order
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void keyboard_softirq(void)
+{
+    uint8_t keyboard_input;
+    while (scancode_tail != scancode_head){
+        keyboard_input = scancode_queue[scancode_tail & SCANCODE_QUEUE_MASK];
+        scancode_tail++;
+        keyboard_process(keyboard_input);
+    }
+}
+
+/*
+ * keyboard_process (for cp2)
+ *   DESCRIPTION: Handle one scancode, it will not print the value of functional keys.
+ *   INPUTS: keyboard_input - scancode from the controller
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: Display all the useful chars on the screen, without left/right/up/down arrow and keypad.
+ */
+static void keyboard_process(uint8_t keyboard_input)
+{
+    unsigned char keyboard_value;       // fill the corresponding value in keyboard scancode array
+    uint32_t flags;
 
     // Release key is out of index, so we need to handle it at first.
     if(special_key_process(keyboard_input) == 0)
@@ -133,7 +181,10 @@ void keyboard_handler()
     // Deal with the condition that input enter.
     if(keyboard_value=='\n')
     {
+        cli_and_save(flags);
         *enter_press = 1;
+        futex_wake_key((uint32_t)enter_press, PID_MAX);
+        restore_flags(flags);
         //read_buffer
         force_putc(keyboard_value);
         strncpy(history_buffer_list[history_key.cur_history].bt_buffer, keyboard_buffer, keyboard_position);
@@ -274,7 +325,7 @@ int special_key_process(uint8_t scancode_special)
     case PRESS_F1:
         if(alt_press)
         {
-            terminal_switch(0);
+            terminal_switch_later(0);
         }
         return 0;
         break;
@@ -282,7 +333,7 @@ int special_key_process(uint8_t scancode_special)
     case PRESS_F2:
         if(alt_press)
         {
-            terminal_switch(1);
+            terminal_switch_later(1);
         }
         return 0;
         break;
@@ -291,7 +342,7 @@ int special_key_process(uint8_t scancode_special)
         if(alt_press)
         {
             
-            terminal_switch(2);
+            terminal_switch_later(2);
         }
         return 0;
         break;
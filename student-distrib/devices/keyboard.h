@@ -57,6 +57,10 @@
 
 #define MAX_BUFFER_SIZE 128
 
+// scancodes waiting for the keyboard softirq, a power of 2
+#define SCANCODE_QUEUE_SIZE 64
+#define SCANCODE_QUEUE_MASK (SCANCODE_QUEUE_SIZE - 1)
+
 #define MAX_HISTORY_BUFFER 135
 #define MEMORY_HISTORY_LEAK 7
 
@@ -84,7 +88,7 @@ extern history_element history_key;
 // init keyboard function
 extern void init_keyboard();
 
-// interrupt handler for keyboard function
+// interrupt handler for keyboard function, the work is done in a softirq
 extern void keyboard_handler();
 
 // deal with special key press
@@ -4,6 +4,7 @@
 #include "../terminal.h"
 #include "../vga_design.h"
 #include "../data/desktop.h"
+#include "../softirq.h"
 
 #define SCREEN_WIDTH_P    720
 #define SCREEN_HEIGHT_P   400
@@ -15,6 +16,14 @@ int32_t mouse_y_pos = 0;
 int32_t mouse_x_pos_old = 0;
 int32_t mouse_y_pos_old = 0;
 
+// packets the interrupt took off the controller, for mouse_softirq
+static volatile mouse_event_t event_queue[MOUSE_QUEUE_SIZE];
+static volatile uint32_t event_head = 0;
+static volatile uint32_t event_tail = 0;
+
+static void mouse_softirq(void);
+static void mouse_process(mouse_packet1_t mouse_packet_1, int32_t mouse_x, int32_t mouse_y);
+
 void mouse_init(void) {
     uint8_t status;
 
@@ -68,9 +77,19 @@ void mouse_init(void) {
     wait_output_to_mouse();
     outb(40, KEYBOARD_PORT);
 
+    open_softirq(SOFTIRQ_MOUSE, mouse_softirq);
     enable_irq(MOUSE_IRQ);
 }
 
+/*
+ * mouse_handler
+ *   DESCRIPTION: Mouse interrupt, take the packet off the controller and
+ *                queue it for mouse_softirq
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: drops bad packets and the ones that find the queue full
+ */
 void mouse_handler() {
     mouse_packet1_t mouse_packet_1;
     mouse_packet_1.val = read_from_mouse();
@@ -80,6 +99,43 @@ void mouse_handler() {
     send_eoi(MOUSE_IRQ);
 
     if (mouse_packet_1.x_overflow || mouse_packet_1.y_overflow || mouse_packet_1.always_1 != 1) return;
+    if (event_head - event_tail >= MOUSE_QUEUE_SIZE) return;
+    event_queue[event_head & MOUSE_QUEUE_MASK].flags = mouse_packet_1.val;
+    event_queue[event_head & MOUSE_QUEUE_MASK].x = mouse_x;
+    event_queue[event_head & MOUSE_QUEUE_MASK].y = mouse_y;
+    event_head++;
+    raise_softirq(SOFTIRQ_MOUSE);
+}
+
+/*
+ * mouse_softirq
+ *   DESCRIPTION: SOFTIRQ_MOUSE handler, process the queued packets in order
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void mouse_softirq(void) {
+    mouse_packet1_t mouse_packet_1;
+    int32_t mouse_x, mouse_y;
+    while (event_tail != event_head) {
+        mouse_packet_1.val = event_queue[event_tail & MOUSE_QUEUE_MASK].flags;
+        mouse_x = event_queue[event_tail & MOUSE_QUEUE_MASK].x;
+        mouse_y = event_queue[event_tail & MOUSE_QUEUE_MASK].y;
+        event_tail++;
+        mouse_process(mouse_packet_1, mouse_x, mouse_y);
+    }
+}
+
+/*
+ * mouse_process
+ *   DESCRIPTION: move and redraw the mouse for one packet, a left click on
+ *                an icon switches terminals or shows the desktop
+ *   INPUTS: mouse_packet_1 - first byte of the packet
+ *           mouse_x, mouse_y - movement bytes of the packet
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void mouse_process(mouse_packet1_t mouse_packet_1, int32_t mouse_x, int32_t mouse_y) {
 
     /* save old mouse position */
     mouse_x_pos_old = mouse_x_pos;
@@ -109,11 +165,11 @@ void mouse_handler() {
 
     if (mouse_packet_1.left_btn == 1) {
         // terminal icon 1
-        if (mouse_x_pos >= 0 && mouse_x_pos < TERMINAL_ICON_BLOCK_DIM && mouse_y_pos < TERMINAL_ICON_BLOCK_DIM && mouse_y_pos >= 0) terminal_switch(0);
+        if (mouse_x_pos >= 0 && mouse_x_pos < TERMINAL_ICON_BLOCK_DIM && mouse_y_pos < TERMINAL_ICON_BLOCK_DIM && mouse_y_pos >= 0) terminal_switch_later(0);
         // terminal icon 2
-        if (mouse_x_pos >= TERMINAL_ICON_BLOCK_DIM && mouse_x_pos < 2*TERMINAL_ICON_BLOCK_DIM && mouse_y_pos < TERMINAL_ICON_BLOCK_DIM && mouse_y_pos >= 0) terminal_switch(1);
+        if (mouse_x_pos >= TERMINAL_ICON_BLOCK_DIM && mouse_x_pos < 2*TERMINAL_ICON_BLOCK_DIM && mouse_y_pos < TERMINAL_ICON_BLOCK_DIM && mouse_y_pos >= 0) terminal_switch_later(1);
         // terminal icon 3
-        if (mouse_x_pos >= 2*TERMINAL_ICON_BLOCK_DIM && mouse_x_pos < 3*TERMINAL_ICON_BLOCK_DIM && mouse_y_pos < TERMINAL_ICON_BLOCK_DIM && mouse_y_pos >= 0) terminal_switch(2);
+        if (mouse_x_pos >= 2*TERMINAL_ICON_BLOCK_DIM && mouse_x_pos < 3*TERMINAL_ICON_BLOCK_DIM && mouse_y_pos < TERMINAL_ICON_BLOCK_DIM && mouse_y_pos >= 0) terminal_switch_later(2);
         // minimize
         if (mouse_x_pos >= qemu_vga_xres - TERMINAL_ICON_BLOCK_DIM && mouse_x_pos < qemu_vga_xres && mouse_y_pos < TERMINAL_ICON_BLOCK_DIM && mouse_y_pos >= 0) qemu_vga_show_picture(DESKTOP_IMAGE_WIDTH, DESKTOP_IMAGE_HEIGHT, QEMU_VGA_DEFAULT_BPP, (uint8_t*)DESKTOP_IMAGE_DATA);
     }
@@ -19,6 +19,10 @@
 #define MOUSE_ENABLE_STREAM         0xF4
 #define MOUSE_SET_SAMPLE_RATE       0xF3
 
+// packets waiting for the mouse softirq, a power of 2
+#define MOUSE_QUEUE_SIZE            32
+#define MOUSE_QUEUE_MASK            (MOUSE_QUEUE_SIZE - 1)
+
 typedef union mouse_packet1_t {
     uint8_t val;
     struct {
@@ -33,6 +37,13 @@ typedef union mouse_packet1_t {
     } __attribute__ ((packed));
 } mouse_packet1_t;
 
+// one packet as the interrupt read it
+typedef struct mouse_event_t {
+    uint8_t flags;
+    uint8_t x;
+    uint8_t y;
+} mouse_event_t;
+
 extern int32_t mouse_x_pos;
 extern int32_t mouse_y_pos;
 extern int32_t mouse_x_pos_old;
@@ -3,9 +3,21 @@
 #include "../lib.h"
 #include "../page.h"
 #include "../process_crtl.h"
-#include "../signal.h"
+#include "../timer.h"
+#include "../ktimer.h"
+#include "../softirq.h"
 // int32_t counter = 0;
 
+// ticks the armed one-shot stands for, 0 while the PIT is periodic
+static uint32_t oneshot_ticks = 0;
+// count the one-shot was started with
+static uint32_t oneshot_count;
+
+static void pit_set_periodic(void);
+static void pit_set_oneshot(uint32_t count);
+static uint32_t pit_read_count(void);
+static void pit_account(uint32_t ticks);
+
 /* pit_init
  *   DESCRIPTION: Initialize PIT
  *   INPUTS: none 
@@ -18,41 +30,149 @@
  */
 
 void pit_init(void) {  
-    /* set the mode to 3 via command  port */
-    outb(PIT_MODE_3, PIT_CMD_PORT);
+    open_softirq(SOFTIRQ_TIMER, run_timers);
+    pit_set_periodic();
+    enable_irq(PIT_IRQ);
+}
+
+/* pit_set_periodic
+ *   DESCRIPTION: tick at 100HZ, counting from now
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void pit_set_periodic(void) {
+    /* set the mode to 2 via command  port */
+    outb(PIT_MODE_2, PIT_CMD_PORT);
 
     /* sent lower 8 bits */
     outb(PIT_FREQ_100HZ & 0x00ff, PIT_CHANNEL_0);
 
     /* sent higher 8 bits */
     outb(PIT_FREQ_100HZ >> 8, PIT_CHANNEL_0);
-    
-    enable_irq(PIT_IRQ);
+}
+
+/* pit_set_oneshot
+ *   DESCRIPTION: interrupt once after count input clocks, then stay quiet
+ *   INPUTS: count - 1 to 0xFFFF
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void pit_set_oneshot(uint32_t count) {
+    outb(PIT_MODE_0, PIT_CMD_PORT);
+    outb(count & 0x00ff, PIT_CHANNEL_0);
+    outb(count >> 8, PIT_CHANNEL_0);
+}
+
+/* pit_read_count
+ *   DESCRIPTION: latch and read the channel 0 counter
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: input clocks left in the current count
+ */
+static uint32_t pit_read_count(void) {
+    uint32_t low;
+    outb(PIT_LATCH_0, PIT_CMD_PORT);
+    low = inb(PIT_CHANNEL_0);
+    return low | (inb(PIT_CHANNEL_0) << 8);
+}
+
+/* pit_account
+ *   DESCRIPTION: let ticks go by: the clock page and the timer wheel see
+ *                every one, also the ones idle skipped
+ *   INPUTS: ticks - ticks that have passed
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: the due timers run from SOFTIRQ_TIMER
+ */
+static void pit_account(uint32_t ticks) {
+    while (ticks-- > 0) {
+        time_tick();
+        timer_tick();
+    }
+    raise_softirq(SOFTIRQ_TIMER);
+}
+
+/* pit_idle_enter
+ *   DESCRIPTION: nothing can run, stop the periodic tick and have the PIT
+ *                fire once when the timer wheel next has work
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: call with interrupts off right before halting
+ */
+void pit_idle_enter(void) {
+#if (TICKLESS_IDLE != 0)
+    uint32_t ticks, left;
+    if (oneshot_ticks != 0 || softirq_pending())
+        return;
+    ticks = next_timer_ticks(PIT_IDLE_MAX_TICKS);
+    if (ticks < 2)
+        return;
+    // the one-shot ends on a tick boundary of the periodic count, skip it
+    // if that tick is too close or already waiting in the PIC
+    left = pit_read_count();
+    if (left < PIT_IDLE_MIN_COUNT || left > PIT_FREQ_100HZ || irq_pending(PIT_IRQ))
+        return;
+    oneshot_ticks = ticks;
+    oneshot_count = left + (ticks - 1) * PIT_FREQ_100HZ;
+    pit_set_oneshot(oneshot_count);
+#endif
+}
+
+/* pit_idle_exit
+ *   DESCRIPTION: something other than the PIT ended the idle halt. Count
+ *                the ticks that went by and have the PIT fire at the next
+ *                tick boundary, where it goes back to periodic.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: call with interrupts off right after halting
+ */
+void pit_idle_exit(void) {
+    uint32_t left, ahead;
+    if (oneshot_ticks == 0 || irq_pending(PIT_IRQ))
+        return;
+    left = pit_read_count();
+    // ran out (mode 0 keeps counting down past 0), the irq is on its way
+    if (left == 0 || left > oneshot_count)
+        return;
+    // tick boundaries sit every PIT_FREQ_100HZ clocks before the end
+    ahead = (left + PIT_FREQ_100HZ - 1) / PIT_FREQ_100HZ;
+    pit_account(oneshot_ticks - ahead);
+    oneshot_ticks = 1;
+    oneshot_count = left - (ahead - 1) * PIT_FREQ_100HZ;
+    pit_set_oneshot(oneshot_count);
 }
 
 
 /* pit_handler
- *   DESCRIPTION: Handle PIT interrupt and call Scheduler
+ *   DESCRIPTION: Handle PIT interrupt, run due kernel timers and call Scheduler.
+ *                The timers run before picking the next process so the ones
+ *                that wake a sleeper count, no switch inside a softirq.
  *   INPUTS: none 
  *   OUTPUTS: none
  *   RETURN VALUE: none
  *   SIDE EFFECTS: call Scheduler
  */
 void pit_handler(void){
+    uint32_t ticks = 1;
     send_eoi(PIT_IRQ);
+    // an idle one-shot ran out, catch up and tick periodically again
+    if (oneshot_ticks != 0) {
+        ticks = oneshot_ticks;
+        oneshot_ticks = 0;
+        pit_set_periodic();
+    }
+    pit_account(ticks);
     // counter = counter + 1;
     // if (counter == 100) {
     //     printf("test pit \n");
     //     counter = 0;
     // }
+    do_softirq();
     // TODO: Scheduler
-    process_crtl_block_t* pcb = get_pcb(cur_pid);
-    pcb->alarm_time += 1;
-    if(pcb->alarm_time == 1000){
-        signal_raise(3);
-        pcb->alarm_time = 0;
-    }
-    if (cur_pid==NULL_PROCESS)
+    if (get_pcb(cur_pid) == NULL || in_softirq())
         return;
     process_switch();
 }
@@ -11,12 +11,23 @@
 #define PIT_CHANNEL_2   0x42
 #define PIT_CMD_PORT    0x43
 
-#define PIT_MODE_3      0x36        /* 0011 0110 use mode 3 (output to irq #0) */
+#define PIT_MODE_2      0x34        /* 0011 0100 rate generator, one count per input clock so it reads back */
+#define PIT_MODE_0      0x30        /* 0011 0000 interrupt once at the end of the count */
+#define PIT_LATCH_0     0x00        /* latch the channel 0 count for reading */
 #define PIT_FREQ_100HZ  11932       /* To get 100HZ (default 1193180) */
 
+/* with nothing to run the periodic tick is stopped and the PIT fires once at
+ * the next timer, at most PIT_IDLE_MAX_TICKS ahead so the count fits 16 bits */
+#define TICKLESS_IDLE       1
+#define PIT_IDLE_MAX_TICKS  5
+/* too close to the next tick to reprogram around it */
+#define PIT_IDLE_MIN_COUNT  128
+
 
 void pit_init(void);
 void pit_handler(void);
+void pit_idle_enter(void);
+void pit_idle_exit(void);
 
 #endif
 
@@ -4,22 +4,23 @@
 #include "../tests.h"
 #include "../lib.h"
 #include "../process_crtl.h"
-#include "../status_bar.h"
-#include "../page.h"
-#include "../cursor_graphic.h"
+#include "../futex.h"
+#include "../memory/slab.h"
 
-volatile int32_t rtc_count[3] = {1, 1, 1};   // initialize the rtc_count
-volatile int32_t read_flag[3] = {0, 0, 0};
-volatile int32_t max_count = 1;
-volatile int32_t rtc_count_date = 1;
-volatile int32_t read_flag_data = 0;
-// volatile int32_t rtc_use[3] = {0, 0, 0};
-int32_t rtc_beep = 1;
-
-int32_t cursor_update = 1024;
+// time in 1/RTC_MAX_FREQ seconds, advanced by every hardware interrupt
+static volatile uint32_t rtc_ticks = 0;
+// rtc_ticks per hardware interrupt, 0 while the hardware is off
+static uint32_t rtc_hw_step = 0;
+// open rtc files at each frequency, by log2 of the frequency
+static int32_t rtc_users[RTC_MAX_SHIFT + 1];
+// readers asleep and the earliest rtc_ticks one of them waits for
+static int32_t rtc_sleepers = 0;
+static uint32_t rtc_wake_at;
 
 void own_test_interrupts(); // define the our own rtc_test function
 int32_t freq_ref(int32_t freq);
+static int32_t freq_shift(int32_t freq);
+static void rtc_set_hw(void);
 
 /*
  * freq_ref
@@ -43,44 +44,91 @@ int32_t freq_ref(int32_t freq){
         default:    return -1;
     }
 }
+/*
+ * freq_shift
+ *   DESCRIPTION: log2 of a valid rtc frequency
+ *   INPUTS: freq - power of two from 2 to RTC_MAX_FREQ
+ *   OUTPUTS: None
+ *   RETURN VALUE: the shift, 1 to RTC_MAX_SHIFT
+ */
+static int32_t freq_shift(int32_t freq){
+    int32_t shift = 0;
+    while ((1 << shift) < freq)
+        shift++;
+    return shift;
+}
+
+/*
+ * rtc_set_hw
+ *   DESCRIPTION: run the chip at the highest frequency an open rtc file
+ *                needs, or stop its interrupts when none is open
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: call with interrupts off, writes registers A and B
+ */
+static void rtc_set_hw(void){
+    int32_t shift;
+    char prev;
+    for (shift = RTC_MAX_SHIFT; shift > 0 && rtc_users[shift] == 0; shift--);
+    outb(RTC_SR_B, RTC_IO);                 // select register B, and disable NMI
+    prev = inb(CMOS_IO);
+    outb(RTC_SR_B, RTC_IO);
+    if (shift == 0){
+        rtc_hw_step = 0;
+        outb(prev & ~SIXTH_BIT, CMOS_IO);   // periodic interrupt off
+        disable_irq(IRQ_RTC);
+        return;
+    }
+    outb(prev | SIXTH_BIT, CMOS_IO);        // periodic interrupt on
+    outb(RTC_SR_A, RTC_IO);
+    prev = inb(CMOS_IO);
+    outb(RTC_SR_A, RTC_IO);
+    // rate r gives 32768 >> (r - 1) HZ
+    outb((prev & LOWER_MASK) | (RTC_RATE_BASE - shift), CMOS_IO);
+    rtc_hw_step = RTC_MAX_FREQ >> shift;
+    enable_irq(IRQ_RTC);
+}
+
 /*
  * rtc_init
- *   DESCRIPTION: Initialize the RTC interrupt. The entry is 8.
+ *   DESCRIPTION: Initialize the RTC interrupt. The entry is 8. The chip
+ *                stays quiet until an rtc file is opened.
  *   INPUTS: none 
  *   OUTPUTS: none
  *   RETURN VALUE: 0 for successful
- *   SIDE EFFECTS: Enable the interrupt request from RTC
+ *   SIDE EFFECTS: Turns the periodic interrupt off
  */
 int32_t rtc_init(){
     // refer to https://wiki.osdev.org/RTC
-    char prev;
-    outb(RTC_SR_B, RTC_IO);		    // select register B, and disable NMI
-    prev = inb(CMOS_IO);	        // read the current value of register B
-    outb(RTC_SR_B, RTC_IO);		    // set the index again (a read will reset the index to register D)
-    outb(prev | SIXTH_BIT, CMOS_IO);	    // write the previous value ORed with 0x40. This turns on bit 6 of register B
-
-
-    outb(RTC_SR_A, RTC_IO);                 // set index to register A, disable NMI
-    prev = inb(CMOS_IO);                        // get initial value of register A
-    outb(RTC_SR_A, RTC_IO);                 // reset index to A
-    outb((prev & LOWER_MASK) | RATE_SET, CMOS_IO);    //write only our rate to A. Note, rate is the bottom 4 bits.
-
-    enable_irq(IRQ_RTC);                    // IRQ number of RTC is 8
+    uint32_t flags;
+    cli_and_save(flags);
+    rtc_set_hw();
+    restore_flags(flags);
     return 0;
 }
 
 /*
  * rtc_open
- *   DESCRIPTION: set the RTC interrupt to 2HZ, which corresponding to 512 counts.
+ *   DESCRIPTION: open a virtual rtc at 2HZ, every open file ticks on its
+ *                own
  *   INPUTS: none 
  *   OUTPUTS: none
- *   RETURN VALUE: 0 for successful
- *   SIDE EFFECTS: Enable the interrupt frequence to 2HZ
+ *   RETURN VALUE: the rtc file, kept as the inode of the open file, -1 if
+ *                 out of memory
+ *   SIDE EFFECTS: may speed up the hardware
  */
 int32_t rtc_open(){
-    rtc_count[cur_terminal_id] = MACCOUNT;
-    // rtc_use[cur_terminal_id] = 1;
-    return 0;
+    rtc_file_t* rtc = (rtc_file_t*)kmalloc(sizeof(rtc_file_t));
+    uint32_t flags;
+    if (rtc == NULL)
+        return -1;
+    rtc->shift = freq_shift(RTC_DEFAULT_FREQ);
+    cli_and_save(flags);
+    rtc_users[rtc->shift]++;
+    rtc_set_hw();
+    restore_flags(flags);
+    return (int32_t)rtc;
 }
 
 /*
@@ -96,151 +144,130 @@ int32_t rtc_open_intf(const uint8_t* filename){
 
 /*
  * rtc_close
- *   DESCRIPTION: close rtc
- *   INPUTS: none 
+ *   DESCRIPTION: close a virtual rtc
+ *   INPUTS: rtc - the rtc file
  *   OUTPUTS: none
  *   RETURN VALUE: 0 for successful
- *   SIDE EFFECTS: 
+ *   SIDE EFFECTS: may slow down or stop the hardware
  */
-int32_t rtc_close(){
+int32_t rtc_close(rtc_file_t* rtc){
+    uint32_t flags;
+    cli_and_save(flags);
+    rtc_users[rtc->shift]--;
+    rtc_set_hw();
+    restore_flags(flags);
+    kfree(rtc);
     return 0;
 }
 
 /*
  * rtc_close_intf
  *   DESCRIPTION: general wrapper function for uniform interface
- *   INPUTS: USELESS
+ *   INPUTS: inode_ptr - points to the rtc file
  *   OUTPUTS: None
  *   RETURN VALUE: follow function inside wrapper
  */
-int32_t rtc_close_intf(int32_t* dummy){
-    return rtc_close();
+int32_t rtc_close_intf(int32_t* inode_ptr){
+    return rtc_close((rtc_file_t*)*inode_ptr);
 }
 
 /*
- * rtc_open
- *   DESCRIPTION: wait for one rtc period, similiar to sleep()
- *   INPUTS: none 
+ * rtc_read
+ *   DESCRIPTION: wait for the next tick of this rtc, similiar to sleep()
+ *   INPUTS: rtc - the rtc file
  *   OUTPUTS: none
- *   RETURN VALUE: 0 for successful
- *   SIDE EFFECTS: sleep()
+ *   RETURN VALUE: 0 for successful, -1 if a signal ended the wait
+ *   SIDE EFFECTS: sleeps on the rtc wait queue
  */
-int32_t rtc_read(){
-    int32_t save_cur_terminal_id = search_owner_terminal(cur_pid); //cur_terminal_id;
-    read_flag[save_cur_terminal_id] = 0;
-    while(read_flag[save_cur_terminal_id] == 0){}
+int32_t rtc_read(rtc_file_t* rtc){
+    uint32_t period = RTC_MAX_FREQ >> rtc->shift;
+    uint32_t flags, target;
+    cli_and_save(flags);
+    // ticks of every rtc file line up with the hardware ones
+    target = (rtc_ticks / period + 1) * period;
+    while ((int32_t)(rtc_ticks - target) < 0){
+        if (rtc_sleepers == 0 || (int32_t)(target - rtc_wake_at) < 0)
+            rtc_wake_at = target;
+        rtc_sleepers++;
+        if (futex_sleep((uint32_t)&rtc_ticks) != SUCCESS){
+            restore_flags(flags);
+            return -1;
+        }
+    }
+    restore_flags(flags);
     return 0;
 }
 
 /*
  * rtc_read_intf
  *   DESCRIPTION: general wrapper function for uniform interface
- *   INPUTS: USELESS
+ *   INPUTS: inode - the rtc file
  *   OUTPUTS: None
  *   RETURN VALUE: follow function inside wrapper
  */
-int32_t rtc_read_intf(int32_t fd, uint32_t* offset, void* buf, int32_t nbytes){
-    return rtc_read();
+int32_t rtc_read_intf(int32_t inode, uint32_t* offset, void* buf, int32_t nbytes){
+    return rtc_read((rtc_file_t*)inode);
 }
 
 /*
  * rtc_write
- *   DESCRIPTION: set the rtc frequence to the required one
- *   INPUTS: none 
+ *   DESCRIPTION: set the frequency of one virtual rtc
+ *   INPUTS: rtc - the rtc file
+ *           freq - power of two from 2 to 1024
  *   OUTPUTS: none
- *   RETURN VALUE: 0 for successful
- *   SIDE EFFECTS: set the max_count
+ *   RETURN VALUE: 0 for successful, -1 for a bad frequency
+ *   SIDE EFFECTS: may change the hardware rate
  */
-int32_t rtc_write(int32_t freq){
+int32_t rtc_write(rtc_file_t* rtc, int32_t freq){
+    uint32_t flags;
     if(freq_ref(freq) == -1){
         return -1;
     }
-    else{
-        max_count = freq_ref(freq);
-        rtc_count[cur_terminal_id] = max_count;
-    }
+    cli_and_save(flags);
+    rtc_users[rtc->shift]--;
+    rtc->shift = freq_shift(freq);
+    rtc_users[rtc->shift]++;
+    rtc_set_hw();
+    restore_flags(flags);
     return 0;
 }
 
 /*
  * rtc_write_intf
  *   DESCRIPTION: general wrapper function for uniform interface
- *   INPUTS: fd - USELESS
+ *   INPUTS: inode - the rtc file
  *           buf - contain 4 bytes for one int
  *           nbytes - must be 4
  *   OUTPUTS: None
  *   RETURN VALUE: follow function inside wrapper, or return -1 on failure
  */
-int32_t rtc_write_intf(int32_t fd, const void* buf, int32_t nbytes){
+int32_t rtc_write_intf(int32_t inode, const void* buf, int32_t nbytes){
     if (nbytes!=4 || buf==NULL)
         return -1;
     int32_t * ptr = (int32_t *)buf;
-    return rtc_write(*ptr);
+    return rtc_write((rtc_file_t*)inode, *ptr);
 }
+
 /*
- * rtc_interrupt (for cp1)
- *   DESCRIPTION: rtc interrupt handler
+ * rtc_interrupt
+ *   DESCRIPTION: rtc interrupt handler, advance the virtual time and wake
+ *                the readers once one of them is due
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: can test the rtc interrupt
+ *   SIDE EFFECTS: wakes rtc readers
  */
 void rtc_interrupt(){
     send_eoi(IRQ_RTC);          // send end-of-interrupt signal
     outb(RTC_SR_C, RTC_IO);     // select registers C
     inb(CMOS_IO);               // discard value
- 
-    int32_t i = 0;
-    rtc_beep++;
-    cursor_update--;
 
-    int screen_x;
-    int screen_y;
-    if((cursor_update/512)==0)
-    {
-        get_screen_pos(&screen_x, &screen_y);
-        graphic_cursor_clear(screen_x, screen_y);
+    rtc_ticks += rtc_hw_step;
+    if (rtc_sleepers != 0 && (int32_t)(rtc_ticks - rtc_wake_at) >= 0){
+        // the ones that are not due yet go back to sleep
+        rtc_sleepers = 0;
+        futex_wake_key((uint32_t)&rtc_ticks, PID_MAX);
     }
-
-    if((cursor_update/512)!=0)
-    {
-        get_screen_pos(&screen_x, &screen_y);
-        graphic_cursor_update(screen_x, screen_y);
-    }
-
-    if(cursor_update==0)
-    {
-        cursor_update=1024;
-    }
-
-    //delete the i
-    for(; i<=2; i++){
-        rtc_count[i] --;
-        if(rtc_count[i] == 0){   
-        rtc_count[i] = max_count;
-        read_flag[i] = 1;
-        update_multi_process_vidmem(i);
-        //clock_update_for_sb();
-        update_multi_process_vidmem(search_owner_terminal(cur_pid));
-
-    }
-    
-    rtc_count_date --;
-    if(rtc_count_date == 0){
-        rtc_count_date = RTC_DATA_COUNT;
-        clock_update_for_sb();
-    }
-    // int32_t save_cur_terminal_id = search_owner_terminal(cur_pid);
-    // rtc_count[save_cur_terminal_id] --;
-    // if(rtc_count[save_cur_terminal_id] == 0){   
-    // rtc_count[save_cur_terminal_id] = max_count;
-    // read_flag[save_cur_terminal_id] = 1; 
-    // #if(RTC_ENABLE_PRINT!=0)
-    //     own_test_interrupts();      // use our own test
-    //     // test_interrupts();       // you can also use the test provided in lib.c
-    // #endif  
-    }
-
 }
 
 /*
@@ -3,7 +3,6 @@
 
 #include "../types.h"
 
-#define RTC_DATA_COUNT 100
 #define MACCOUNT    512     // count used for the rtc_interrupt interval
 #define RTC_SR_A    0x8A    // RTC status register A
 #define RTC_SR_B    0x8B    // RTC status register B     
@@ -14,27 +13,35 @@
 
 #define LOWER_MASK  0xF0    // clear lower 4 bits
 #define SIXTH_BIT  0x40     // get 6th bit
-#define RATE_SET    0x06    // set rate
+#define RTC_RATE_BASE 16    // rate for 2^shift HZ is RTC_RATE_BASE - shift
+
+#define RTC_MAX_FREQ     1024   // fastest rtc a file can ask for
+#define RTC_MAX_SHIFT    10     // log2 of RTC_MAX_FREQ
+#define RTC_DEFAULT_FREQ 2      // frequency of a newly opened rtc
 
 #define RTC_MESSAGE_LEN 30  //length of message string.
 
+/* one open rtc file. The chip runs at the fastest frequency any open file
+ * asks for, and each file sees only every n-th of its ticks. */
+typedef struct {
+    // log2 of the frequency of this file
+    int32_t shift;
+} rtc_file_t;
+
 // Initialize the RTC interrupt. The entry is 8.
 extern int32_t rtc_init();
-// using as rtc count, for our printing test
-extern volatile int32_t rtc_count[3];
-extern int32_t rtc_beep;
-// set the RTC interrupt to 2HZ, which corresponding to 512 counts
+// open a virtual rtc at 2HZ
 extern int32_t rtc_open();
 extern int32_t rtc_open_intf(const uint8_t* filename);
 // close rtc
-extern int32_t rtc_close();
-extern int32_t rtc_close_intf(int32_t* dummy);
+extern int32_t rtc_close(rtc_file_t* rtc);
+extern int32_t rtc_close_intf(int32_t* inode_ptr);
 // wait for one rtc period, similiar to sleep()
-extern int32_t rtc_read();
-extern int32_t rtc_read_intf(int32_t fd, uint32_t* offset, void* buf, int32_t nbytes);
+extern int32_t rtc_read(rtc_file_t* rtc);
+extern int32_t rtc_read_intf(int32_t inode, uint32_t* offset, void* buf, int32_t nbytes);
 // set the rtc frequence to the required one
-extern int32_t rtc_write(int32_t freq);
-extern int32_t rtc_write_intf(int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t rtc_write(rtc_file_t* rtc, int32_t freq);
+extern int32_t rtc_write_intf(int32_t inode, const void* buf, int32_t nbytes);
 //rtc interrupt function
 extern void rtc_interrupt();
 #endif
@@ -1,6 +1,6 @@
 #include "speaker.h"
 #include "../lib.h"
-#include "rtc.h"
+#include "../do_syscall.h"
 
 //Code reference: https://wiki.osdev.org/Text_Mode_Cursor
 
@@ -67,8 +67,7 @@ void speaker_beep() {
     uint32_t freq = tone[0];
     for (i = 0; i < 42; i++){
         freq = tone[i%7];
-        rtc_beep = 0;
-        while(rtc_beep < 128) {}
+        sleep_ms(BEEP_NOTE_MS);
         if (i % 2 == 0) speaker_play_sound(freq);
         else speaker_no_sound();
     }
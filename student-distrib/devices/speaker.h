@@ -10,6 +10,7 @@
 #define SPEAKER_MUTE_MASK           0xFC        // 1011 0110 use mode 3 (output to irq #0)
 #define SPEAKER_UNMUTE_MASK         0x03
 #define SPEAKER_MODE                0xB6
+#define BEEP_NOTE_MS                125         // each note and each pause
 
 void speaker_play_sound(uint32_t freq);
 void speaker_no_sound();
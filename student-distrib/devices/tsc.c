@@ -0,0 +1,129 @@
+#include "tsc.h"
+#include "../lib.h"
+#include "../timer.h"
+#include "speaker.h"
+
+#define CPUID_TSC   0x10
+
+// 0 while the TSC is unusable, ktime_ns then counts PIT ticks
+static uint32_t tsc_freq_khz = 0;
+static uint32_t tsc_mult = 0;
+static uint64_t tsc_boot = 0;
+
+static uint32_t div64_32(uint64_t n, uint32_t d);
+
+/*
+ * tsc_init
+ *   DESCRIPTION: measure the TSC against 10ms of PIT channel 2, the one the
+ *                speaker uses, and pick the cycles to ns factor
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: busy waits 10ms, mutes the speaker. ktime_ns counts from
+ *                 here.
+ */
+void tsc_init(void){
+    uint32_t eax, ebx, ecx, edx, flags;
+    uint64_t start, end;
+    uint8_t gate;
+    asm volatile ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    if (!(edx & CPUID_TSC))
+        return;
+
+    cli_and_save(flags);
+    gate = inb(KEYBOARD_CONTROLLER_PORT);
+    outb((gate & ~TSC_SPEAKER_ON) | TSC_PIT_GATE, KEYBOARD_CONTROLLER_PORT);
+    outb(TSC_PIT_MODE_0, SPEAKER_CMD_PORT);
+    outb(TSC_CALIBRATE_COUNT & 0xFF, SPEAKER_DATA_PORT);
+    outb(TSC_CALIBRATE_COUNT >> 8, SPEAKER_DATA_PORT);
+    start = tsc_read();
+    // mode 0 raises the output once the count runs out
+    while (!(inb(KEYBOARD_CONTROLLER_PORT) & TSC_PIT_OUT));
+    end = tsc_read();
+    outb(gate & ~TSC_SPEAKER_ON, KEYBOARD_CONTROLLER_PORT);
+    restore_flags(flags);
+
+    // kHz keeps the quotient in 32 bits for any TSC below 4THz
+    tsc_freq_khz = div64_32((uint64_t)(uint32_t)(end - start) * TSC_PIT_FREQ, TSC_CALIBRATE_COUNT * 1000);
+    if (tsc_freq_khz == 0)
+        return;
+    tsc_mult = div64_32((uint64_t)1000000 << TSC_SHIFT, tsc_freq_khz);
+    tsc_boot = end;
+}
+
+/*
+ * tsc_khz
+ *   DESCRIPTION: calibrated TSC frequency
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: kHz, 0 if there is no usable TSC
+ */
+uint32_t tsc_khz(void){
+    return tsc_freq_khz;
+}
+
+/*
+ * tsc_read
+ *   DESCRIPTION: read the time stamp counter
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: cycles since reset
+ */
+uint64_t tsc_read(void){
+    uint64_t cycles;
+    asm volatile ("rdtsc" : "=A"(cycles));
+    return cycles;
+}
+
+/*
+ * tsc_to_ns
+ *   DESCRIPTION: convert TSC cycles to nanoseconds with 32 bit multiplies,
+ *                the high and low halves are scaled separately
+ *   INPUTS: cycles - a cycle count
+ *   OUTPUTS: none
+ *   RETURN VALUE: nanoseconds
+ */
+uint64_t tsc_to_ns(uint64_t cycles){
+    uint32_t lo = (uint32_t)cycles;
+    uint32_t hi = (uint32_t)(cycles >> 32);
+    return (((uint64_t)hi * tsc_mult) << (32 - TSC_SHIFT)) + (((uint64_t)lo * tsc_mult) >> TSC_SHIFT);
+}
+
+/*
+ * ktime_ns
+ *   DESCRIPTION: monotonic nanoseconds since boot, from the TSC, or at
+ *                tick resolution from the time page without one
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: nanoseconds
+ */
+uint64_t ktime_ns(void){
+    uint32_t seq, sec, nsec;
+    if (tsc_freq_khz != 0)
+        return tsc_to_ns(tsc_read() - tsc_boot);
+    if (time_page == NULL)
+        return 0;
+    do {
+        while ((seq = time_page->seq) & 1);
+        sec = time_page->mono_sec;
+        nsec = time_page->mono_nsec;
+    } while (seq != time_page->seq);
+    return (uint64_t)sec * NSEC_PER_SEC + nsec;
+}
+
+/*
+ * div64_32
+ *   DESCRIPTION: 64 by 32 bit division with one divl, the kernel has no
+ *                libgcc for 64 bit division
+ *   INPUTS: n - dividend, n >> 32 must be below d
+ *           d - divisor
+ *   OUTPUTS: none
+ *   RETURN VALUE: n / d
+ */
+static uint32_t div64_32(uint64_t n, uint32_t d){
+    uint32_t q, r;
+    if ((uint32_t)(n >> 32) >= d)
+        return 0;
+    asm ("divl %4" : "=a"(q), "=d"(r) : "a"((uint32_t)n), "d"((uint32_t)(n >> 32)), "rm"(d));
+    return q;
+}
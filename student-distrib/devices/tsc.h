@@ -0,0 +1,23 @@
+#ifndef _TSC_H
+#define _TSC_H
+
+#include "../types.h"
+
+/* the TSC is timed against PIT channel 2 counting down for 10ms */
+#define TSC_CALIBRATE_COUNT     11932
+#define TSC_PIT_FREQ            1193182
+#define TSC_PIT_MODE_0          0xB0        /* channel 2, lo/hi byte, mode 0 */
+#define TSC_PIT_GATE            0x01        /* port 0x61: channel 2 gate */
+#define TSC_SPEAKER_ON          0x02        /* port 0x61: speaker data */
+#define TSC_PIT_OUT             0x20        /* port 0x61: channel 2 output */
+
+/* cycles to ns: ns = cycles * mult >> TSC_SHIFT */
+#define TSC_SHIFT               22
+
+void tsc_init(void);
+uint32_t tsc_khz(void);
+uint64_t tsc_read(void);
+uint64_t tsc_to_ns(uint64_t cycles);
+uint64_t ktime_ns(void);
+
+#endif /* _TSC_H */
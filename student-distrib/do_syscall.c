@@ -8,6 +8,14 @@
 #include "vga_design.h"
 #include "lib.h"
 #include "devices/speaker.h"
+#include "pipe.h"
+#include "futex.h"
+#include "elf.h"
+#include "devices/tsc.h"
+#include "ktimer.h"
+#include "devices/i8259.h"
+#include "signal.h"
+#include "memory/vm.h"
 
 
 
@@ -17,25 +25,11 @@
 // static helper functions
 static int32_t parse_argument(const int8_t* command, uint8_t* filename, uint8_t* args);
 static int32_t check_executable(uint8_t* filename);
-static void close_terminal_file(file_desc_entry_t* fda);
+static int32_t seek_end(file_desc_entry_t* file);
+static void sleep_wakeup(uint32_t data);
 
 file_ops_table_t empty_op = {NULL, NULL, NULL, NULL};
 
-/*
- * close_terminal_file
- *   DESCRIPTION: close stdin and stdout
- *   INPUTS: fda - file descriptor array
- *   OUTPUTS: None
- *   RETURN VALUE: None
- */
-static void close_terminal_file(file_desc_entry_t* fda){
-    fda[0].flags = FILE_FLAG_FREE;
-    fda[0].file_op = empty_op;
-    fda[1].flags = FILE_FLAG_FREE;
-    fda[1].file_op = empty_op;
-}
-
-
 /*
  * halt
  *   DESCRIPTION: halt a program, return from execute stack frame
@@ -53,48 +47,25 @@ int32_t halt (uint8_t status)
         sti();
         return FAILURE;
     }
+    /* halt in a thread only ends that thread */
+    if (cur_pcb->leader != cur_pcb)
+        return thread_exit(status);
+    exit_threads(cur_pcb);
 
-    if (cur_pcb->parent_pid == NULL_PROCESS) {
+    if (cur_pcb->terminal_root) {
         /* current process is the base shell, need to restart */
         printf("==== DON'T EXIT ROOT SHELL ==== \n");
+        set_process_pd(NULL_PROCESS);
         free_process(cur_pid);
+        // the pcb is gone with its kernel stack, don't treat it as the parent
+        cur_pid = NULL_PROCESS;
         terminal_list[cur_terminal_id].shell_opened = 0;
         execute("shell");
     } else {
         /* current process is not the base shell */
-        int32_t parent_pid, parent_esp, parent_ebp;
-        parent_pid = cur_pcb->parent_pid;
-        process_crtl_block_t * parent_pcb = get_pcb(parent_pid);
-        parent_esp = parent_pcb->esp;
-        parent_ebp = parent_pcb->ebp;
-
-        /* restore the parent data */
-        // tss.esp0 = KERNEL_STACK_SIZE - parent_pid * KERNEL_STACK_SIZE - 4;
-        tss.esp0 = parent_pcb->tss_esp0;
-        tss.ss0 = KERNEL_DS;
-
-        /* restore the parent paging */
-        set_user_pt(parent_pid);
-
-        /* close any relevant FDs */
-        int32_t i, ret;
-        file_desc_entry_t* cur_fda = cur_pcb->fda;
-        if (cur_fda == NULL) {
-            sti();
-            return FAILURE;
-        }
-        close_terminal_file(cur_fda);
-        for (i = 2; i < MAX_PROCESS_FILE_NUM; i++) {
-            /* close opened files/devices */
-            if (cur_fda[i].flags == FILE_FLAG_IN_USE) {
-                ret = close(i);
-                if (ret == -1) {
-                    printf("fail to close file\n");
-                    sti();
-                    return FAILURE;
-                }
-            }
-        }
+        /* close any relevant FDs, pipe ends see the close right away even
+         * if we stay around as a zombie */
+        fd_table_destroy(cur_pcb->fd_table);
         /* close vidmap */ 
         if (cur_pcb->use_vidmem){
             // disable_user_vidmem(cur_pcb->vmem);
@@ -112,12 +83,48 @@ int32_t halt (uint8_t status)
                 close_user_vidmem_for_switch((uint8_t*) USR_VIDMEM_ADDR, (uint32_t) terminal_list[search_owner_terminal(cur_pid)].video_buffer);
             }
         }
+
+        if(halt_flag == 1)
+        {
+            halt_flag = 0;
+            status_new = EXCEPTION_HANDLER;
+        }
+
+        if (!cur_pcb->parent_waiting || get_pcb(cur_pcb->parent_pid) == NULL) {
+            /* forked or spawned child, or the thread that executed us is
+             * gone: nobody sits in execute for us. Keep the status for
+             * waitpid, orphans are reaped by the scheduler */
+            cur_pcb->exit_status = status_new;
+            cur_pcb->status = ZOMBIE;
+            cur_pcb->is_running = NOT_RUNNING;
+            if (get_pcb(cur_pcb->parent_pid) != NULL){
+                signal_send(get_pcb(cur_pcb->parent_pid), CHILD);
+                futex_wake_key((uint32_t)get_pcb(cur_pcb->parent_pid), PID_MAX);
+            }
+            process_exit_switch();
+        }
+
+        int32_t parent_pid, parent_esp, parent_ebp;
+        parent_pid = cur_pcb->parent_pid;
+        process_crtl_block_t * parent_pcb = get_pcb(parent_pid);
+        parent_esp = parent_pcb->esp;
+        parent_ebp = parent_pcb->ebp;
+
+        /* restore the parent data */
+        // tss.esp0 = KERNEL_STACK_SIZE - parent_pid * KERNEL_STACK_SIZE - 4;
+        tss.esp0 = parent_pcb->tss_esp0;
+        tss.ss0 = KERNEL_DS;
+
+        /* restore the parent paging */
+        set_process_pd(parent_pid);
+
         /* update cur_pid */
         free_process(cur_pid);
-        process_map[parent_pid].is_running = RUNNING;
+        parent_pcb->is_running = RUNNING;
         // TODO: SYNC PROBLEM HERE
         cur_pid = parent_pid;
-        sti();
+        /* interrupts stay off until we are back on the parent stack, the
+         * kernel stack we are running on was just freed */
         /* restore parent esp and ebp, switch back to the parent user stack */
         // asm volatile (
         //     "xorl %%eax, %%eax;"
@@ -131,12 +138,6 @@ int32_t halt (uint8_t status)
         //     : "eax", "esp", "ebp"
         // );
 
-        if(halt_flag == 1)
-        {
-            halt_flag = 0;
-            status_new = EXCEPTION_HANDLER;
-        }
-
         jump_to_execute_return(status_new, parent_esp, parent_ebp);
     }
     sti();
@@ -209,29 +210,160 @@ static int32_t parse_argument(const int8_t* command, uint8_t* filename, uint8_t*
 
 /*
  * check_executable
- *   DESCRIPTION: check if the file is executable
+ *   DESCRIPTION: check if the file is an executable we can load
  *   INPUTS: filename
  *   OUTPUTS: None
  *   RETURN VALUE: 0 for success and -1 for failure
  */
 static int32_t check_executable(uint8_t* filename){
     dentry_t dir_dentry;
-    char buf[EXECTURE_BUF_SIZE];
+    elf_header_t header;
+    inode_blk_t* inode;
     int ret = read_dentry_by_name((char*)filename, &dir_dentry);
     if (ret==FAILURE)
         return FAILURE;
-    read_data(dir_dentry.inode,0,buf,4);
-    // magic number to check if the file is executable
-    // number referred from mp3 document appendix C
-    if (buf[0]!=0x7f || buf[1]!=0x45 || buf[2]!=0x4c || buf[3]!=0x46)
+    inode = (inode_blk_t*)fs_start_ptr + 1 + dir_dentry.inode;
+    return elf_check(dir_dentry.inode, inode->size, &header);
+}
+
+/*
+ * load_program
+ *   DESCRIPTION: parse one command, check the executable, make a new process
+ *                and load the program into it
+ *   INPUTS: command - program name and argument
+ *           flags - PROCESS_FORK or PROCESS_NO_FORK, see create_PCB
+ *   OUTPUTS: None
+ *   RETURN VALUE: the new pcb, its address space is the live one.
+ *                 NULL for failure, the current address space is kept.
+ */
+static process_crtl_block_t* load_program(const int8_t* command, int32_t flags)
+{
+    uint8_t filename[MAX_COMMEND_ARG];
+    uint8_t arg[MAX_COMMEND_ARG];
+    int32_t next_pid;
+    process_crtl_block_t* new_pcb;
+
+    // parse arg
+    parse_argument(command, filename, arg);
+
+    // check for executable 
+    if (check_executable(filename)==FAILURE)
+        return NULL;
+
+    // set up paging
+    next_pid = allocate_process();
+    if (next_pid == FAILURE){
+        printf("NO MORE PROCESS!\n");
+        return NULL;
+    }
+    set_process_pd(next_pid);
+
+    // load file into memory
+    if (load_file_tomemory(filename, get_pcb(next_pid))==FAILURE){
+        // restore paging back
+        set_process_pd(cur_pid);
+        free_process(next_pid);
+        return NULL;
+    }
+    // create PCB
+    new_pcb = create_PCB(next_pid, (int8_t*)arg, flags);
+    strcpy((char*) &(new_pcb->cmd), (char*) filename);
+    return new_pcb;
+}
+
+/*
+ * set_stdio
+ *   DESCRIPTION: hand pipe ends to a new process as its stdin/stdout
+ *   INPUTS: pcb - the new process
+ *           in - file for stdin, terminal if NULL
+ *           out - file for stdout, terminal if NULL
+ *   OUTPUTS: None
+ *   RETURN VALUE: None
+ *   SIDE EFFECTS: the new process takes its own reference on the files
+ */
+static void set_stdio(process_crtl_block_t* pcb, file_desc_entry_t* in, file_desc_entry_t* out)
+{
+    if (in != NULL){
+        file_get(in);
+        fd_set(pcb->fd_table, 0, in);
+    }
+    if (out != NULL){
+        file_get(out);
+        fd_set(pcb->fd_table, 1, out);
+    }
+}
+
+/*
+ * close_entry
+ *   DESCRIPTION: drop a file that is not in any fd table
+ *   INPUTS: file - the file, may be NULL
+ *   OUTPUTS: None
+ *   RETURN VALUE: None
+ */
+static void close_entry(file_desc_entry_t* file)
+{
+    if (file != NULL)
+        file_put(file);
+}
+
+/*
+ * pipe_files
+ *   DESCRIPTION: make a pipe and the two open files for its ends
+ *   INPUTS: none
+ *   OUTPUTS: read_end, write_end - the files, one reference each
+ *   RETURN VALUE: 0 for success and -1 if out of memory
+ */
+static int32_t pipe_files(file_desc_entry_t** read_end, file_desc_entry_t** write_end)
+{
+    *read_end = file_alloc();
+    *write_end = file_alloc();
+    if (*read_end == NULL || *write_end == NULL || pipe_create(*read_end, *write_end) == FAILURE){
+        // no close operation yet, this only frees them
+        close_entry(*read_end);
+        close_entry(*write_end);
         return FAILURE;
+    }
     return SUCCESS;
 }
 
+/*
+ * start_background
+ *   DESCRIPTION: start a command next to the caller, as a child of the
+ *                current process that nobody sits in execute for
+ *   INPUTS: command - program name and argument
+ *           in - stdin for the child, terminal unless in use
+ *           out - stdout for the child, terminal unless in use
+ *   OUTPUTS: None
+ *   RETURN VALUE: the new pcb, NULL for failure
+ */
+static process_crtl_block_t* start_background(const int8_t* command, file_desc_entry_t* in, file_desc_entry_t* out)
+{
+    sig_regs regs;
+    process_crtl_block_t* new_pcb = load_program(command, PROCESS_FORK);
+    if (new_pcb == NULL)
+        return NULL;
+    // same user context save_iret_context builds
+    set_process_pd(cur_pid);
+    memset(&regs, 0, sizeof(regs));
+    regs.eip = new_pcb->entry;
+    regs.cs = USER_CS;
+    regs.ds = regs.es = regs.fs = regs.ss = USER_DS;
+    regs.EFLAGS = USER_EFLAGS;
+    regs.useresp = USER_MEMORY + USER_STACK_SIZE - USER_OFFSET;
+    prepare_user_return(new_pcb, &regs);
+
+    set_stdio(new_pcb, in, out);
+    new_pcb->parent_waiting = 0;
+    new_pcb->is_running = RUNNING;
+    return new_pcb;
+}
+
 /*
  * execute
  *   DESCRIPTION: execute the command, including five steps: parse arguments, check for executable, set up paging, load file into memory,
  *                create PCB, prepare for the context switch, push iret context to kernel stack and iret.
+ *                For "cmd1 | cmd2 | ..." every command but the last one is started in the background with its stdout piped into
+ *                the next command's stdin, and only the last one is waited for.
  *   INPUTS: command 
  *   OUTPUTS: Nothing.
  *   RETURN VALUE: 0 for success and -1 for failure
@@ -239,48 +371,61 @@ static int32_t check_executable(uint8_t* filename){
 
 int32_t execute(const int8_t* command)
 {
+    int8_t stage[MAX_COMMEND_ARG];
+    file_desc_entry_t* pipe_in = NULL;
+    file_desc_entry_t* read_end;
+    file_desc_entry_t* write_end;
+    process_crtl_block_t* new_pcb;
+    int32_t i, len;
     if (command == NULL)
         return FAILURE;
     // forbid the interrupt.
     cli();
 
-    // parse arg
-    uint8_t filename[MAX_COMMEND_ARG]; 
-    uint8_t arg[MAX_COMMEND_ARG];
-    parse_argument(command, filename, arg);
-
-    // check for executable 
-    if (check_executable(filename)==FAILURE){
-        sti();
-        return FAILURE;
-    }
-
-    // set up paging
-    int32_t next_pid = allocate_process();
-    if (next_pid == FAILURE){
-        printf("NO MORE PROCESS!\n");
-        sti();
-        return FAILURE;
+    // pipeline stages, the read end of each pipe feeds the next stage
+    while (1){
+        for (len = 0; command[len] != '\0' && command[len] != '|'; len++);
+        if (command[len] != '|')
+            break;
+        if (len >= MAX_COMMEND_ARG)
+            len = MAX_COMMEND_ARG - 1;
+        for (i = 0; i < len; i++)
+            stage[i] = command[i];
+        stage[len] = '\0';
+        if (pipe_files(&read_end, &write_end) == FAILURE){
+            close_entry(pipe_in);
+            sti();
+            return FAILURE;
+        }
+        new_pcb = start_background(stage, pipe_in, write_end);
+        close_entry(pipe_in);
+        close_entry(write_end);
+        // nobody waits for a pipeline stage, reap it once it halts
+        if (new_pcb != NULL)
+            new_pcb->parent_pid = NULL_PROCESS;
+        if (new_pcb == NULL){
+            close_entry(read_end);
+            sti();
+            return FAILURE;
+        }
+        pipe_in = read_end;
+        while (*command != '|')
+            command++;
+        command++;
     }
 
-    set_user_pt(next_pid);
-
-    // load file into memory
-    int load_result = load_file_tomemory(filename);
-    if (load_result==FAILURE){
-        // restore paging back
-        set_user_pt(cur_pid);
+    int32_t process_fork_flag = terminal_list[cur_terminal_id].shell_opened == 0? PROCESS_NO_FORK : PROCESS_FORK;
+    new_pcb = load_program(command, process_fork_flag);
+    if (new_pcb == NULL){
+        close_entry(pipe_in);
         sti();
         return FAILURE;
     }
-    int32_t process_fork_flag = terminal_list[cur_terminal_id].shell_opened == 0? PROCESS_NO_FORK : PROCESS_FORK;
-    if (!strncmp((int8_t*)filename,(int8_t*)"shell",6)){
+    if (!strncmp((int8_t*)new_pcb->cmd,(int8_t*)"shell",6)){
         terminal_list[cur_terminal_id].shell_opened = 1;
     }
-    // create PCB
-    process_crtl_block_t* new_pcb = create_PCB(next_pid, (int8_t*)arg, process_fork_flag);
-    // printf("%s", filename);
-    strcpy((char*) &(new_pcb->cmd), (char*) filename);
+    set_stdio(new_pcb, pipe_in, NULL);
+    close_entry(pipe_in);
 
     // prepare for context switch
     process_crtl_block_t* cur_pcb_ptr = get_cur_pcb();
@@ -302,10 +447,11 @@ int32_t execute(const int8_t* command)
         cur_pcb_ptr->esp = esp_backup;
     }
     // ready for everything for new process
-    process_map[cur_pid].is_running = (process_fork_flag==PROCESS_FORK) ? NOT_RUNNING : RUNNING;
-    process_map[next_pid].is_running = RUNNING;
+    if (cur_pcb_ptr != NULL)
+        cur_pcb_ptr->is_running = (process_fork_flag==PROCESS_FORK) ? NOT_RUNNING : RUNNING;
+    new_pcb->is_running = RUNNING;
     // update global variable cur_pid
-    cur_pid = next_pid;
+    cur_pid = new_pcb->pid;
 
     active_terminal = search_owner_terminal(cur_pid);
     // maybe we should update the video memory
@@ -331,22 +477,18 @@ int32_t execute(const int8_t* command)
  */
 int32_t read (int32_t fd, void* buf, int32_t nbytes)
 {
-    if (fd<MIN_FDA || fd>=MAX_FDA)
-        return FAILURE;
     process_crtl_block_t * cur_pcb = get_cur_pcb();
-    file_desc_entry_t* file = &(cur_pcb->fda[fd]);
-    if (cur_pcb==NULL || file==NULL)
+    if (cur_pcb==NULL)
         return FAILURE;
-    if (file->flags==FILE_FLAG_IN_USE){
-        if (file->file_op.read == NULL)
-            return FAILURE;
-        //printf("read success!\n");
-        return (file->file_op).read(file->inode, &(file->file_pos), buf, nbytes);
-    }
-    else{
-        // printf("haven't opened the file\n");
+    file_desc_entry_t* file = fd_get(cur_pcb->fd_table, fd);
+    if (file==NULL || file->file_op.read == NULL)
         return FAILURE;
-    }
+    // kernel callers, e.g. the tests, read into their own buffers
+    if ((uint32_t)buf >= USER_MEMORY && nbytes > 0
+        && vm_user_writable(cur_pcb, (uint32_t)buf, nbytes) == FAILURE)
+        return FAILURE;
+    //printf("read success!\n");
+    return (file->file_op).read(file->inode, &(file->file_pos), buf, nbytes);
 }
 
 /*
@@ -360,22 +502,14 @@ int32_t read (int32_t fd, void* buf, int32_t nbytes)
  */
 int32_t write (int32_t fd, const void* buf, int32_t nbytes)
 {
-    if (fd<MIN_FDA || fd>=MAX_FDA)
-        return FAILURE;
     process_crtl_block_t * cur_pcb = get_cur_pcb();
-    file_desc_entry_t* file = &(cur_pcb->fda[fd]);
-    if (cur_pcb==NULL || file==NULL)
-        return -1;
-    if (file->flags==FILE_FLAG_IN_USE){
-        if (file->file_op.write == NULL)
-            return FAILURE;
-        //printf("Write success!\n");
-        return (file->file_op).write(file->inode, buf, nbytes);
-    }
-    else{
-        // printf("haven't opened the file\n");
+    if (cur_pcb==NULL)
         return FAILURE;
-    }
+    file_desc_entry_t* file = fd_get(cur_pcb->fd_table, fd);
+    if (file==NULL || file->file_op.write == NULL)
+        return FAILURE;
+    //printf("Write success!\n");
+    return (file->file_op).write(file->inode, buf, nbytes);
 }   
 
 /*
@@ -395,17 +529,9 @@ int32_t open (const uint8_t* filename)
     process_crtl_block_t * cur_pcb = get_cur_pcb();
     if (cur_pcb==NULL)
         return FAILURE;
-    int32_t i, found_free_slot, ret;
-    file_desc_entry_t * file;
-    found_free_slot = 0;
-    for (i=2; i<MAX_PROCESS_FILE_NUM; i++){
-        if (cur_pcb->fda[i].flags==FILE_FLAG_FREE){
-            found_free_slot = 1;
-            file = &(cur_pcb->fda[i]);
-            break;
-        }
-    }
-    if (found_free_slot==0 || file==NULL)
+    int32_t fd, ret;
+    file_desc_entry_t * file = file_alloc();
+    if (file==NULL)
         return FAILURE;
     // parse the filename, load function operations
     if (!strncmp((int8_t*)filename, dirname, strlen((int8_t*)filename)+1)){
@@ -421,18 +547,22 @@ int32_t open (const uint8_t* filename)
         file_type = 2;
         file->file_op = get_file_ops(2);
     }
-    if (file->file_op.open == NULL)
-        return FAILURE;
     // call open function
-    ret = file->file_op.open(filename);
-    if (ret==FAILURE)
+    ret = (file->file_op.open == NULL) ? FAILURE : file->file_op.open(filename);
+    if (ret==FAILURE){
+        // nothing is open yet, free the file without closing it
+        file->file_op = empty_op;
+        file_put(file);
         return FAILURE;
-    file->flags = FILE_FLAG_IN_USE;
+    }
     file->file_pos = 0;
-    file->inode = (file_type==2)? ret : 0;
+    // files and rtcs keep what open returned, the inode or the virtual rtc
+    file->inode = (file_type==1)? 0 : ret;
     //printf("open success!\n");
-    // i is the fd for this open
-    return i;
+    fd = fd_install(cur_pcb->fd_table, file);
+    if (fd==FAILURE)
+        file_put(file);
+    return fd;
 }
 
 /*
@@ -444,20 +574,16 @@ int32_t open (const uint8_t* filename)
  */
 int32_t close (int32_t fd)
 {
-    if (fd<MIN_FDA || fd>=MAX_FDA)
-        return FAILURE;
     process_crtl_block_t * cur_pcb = get_cur_pcb();
-    file_desc_entry_t* file = &(cur_pcb->fda[fd]);
-    int32_t ret;
-    if (cur_pcb==NULL || file==NULL || file->file_op.close==NULL || file->flags==FILE_FLAG_FREE)
+    if (cur_pcb==NULL)
         return FAILURE;
-    ret = file->file_op.close(&(file->inode));
-    if (ret==FAILURE)
+    file_desc_entry_t* file = fd_get(cur_pcb->fd_table, fd);
+    // stdin and stdout on the terminal stay open, copies of them may close
+    if (file==NULL || (file->file_op.close==NULL && fd < 2))
         return FAILURE;
-    // close success
-    file->file_pos = 0;
-    file->file_op = empty_op;
-    file->flags = FILE_FLAG_FREE;
+    fd_remove(cur_pcb->fd_table, fd);
+    // the file itself is closed with its last fd
+    file_put(file);
 
     //printf("close success!\n");
     return 0;
@@ -485,6 +611,10 @@ int32_t getargs (uint8_t* buf, int32_t nbytes)
     if(current_pcb->cmd_arg[0] == NULL)
         return FAILURE;
 
+    // the whole buffer is written, strncpy pads it with zeros
+    if(nbytes < 0 || vm_user_writable(current_pcb, (uint32_t)buf, nbytes) == FAILURE)
+        return FAILURE;
+
     // copy the current cmd argument to the buffer
     strncpy((int8_t*)buf, (int8_t*)(current_pcb->cmd_arg), nbytes);
     
@@ -513,21 +643,23 @@ int32_t vidmap (uint8_t** screen_start)
     process_crtl_block_t * cur_pcb = get_cur_pcb();
     // set target video memory address
     uint8_t * target_vidmem_addr = (uint8_t *)USR_VIDMEM_ADDR;
-    *screen_start = target_vidmem_addr;
-    if (cur_pcb==NULL)
+    if (cur_pcb==NULL || vm_user_writable(cur_pcb, (uint32_t)screen_start, sizeof(uint8_t*)) == FAILURE)
         return FAILURE;
+    *screen_start = target_vidmem_addr;
     // set up the video map for user
+    int32_t ret;
     if(search_process(cur_terminal_id))
     {
-        setup_user_vidmem_for_switch(target_vidmem_addr, VIDEO_MEM_BEGIN);
+        ret = setup_user_vidmem_for_switch(target_vidmem_addr, VIDEO_MEM_BEGIN);
     }else{
-        setup_user_vidmem_for_switch(target_vidmem_addr, (uint32_t) terminal_list[search_owner_terminal(cur_pid)].video_buffer);
+        ret = setup_user_vidmem_for_switch(target_vidmem_addr, (uint32_t) terminal_list[search_owner_terminal(cur_pid)].video_buffer);
     }
-    flush_tlb();
+    if (ret == FAILURE)
+        return FAILURE;
 
-    // set relevant parameters 
-    cur_pcb->vmem = target_vidmem_addr;
-    cur_pcb->use_vidmem = 1;
+    // set relevant parameters, the mapping belongs to the whole process
+    cur_pcb->leader->vmem = target_vidmem_addr;
+    cur_pcb->leader->use_vidmem = 1;
 
     terminal_list[search_owner_terminal(cur_pid)].vidmap = 1;
     // success
@@ -570,26 +702,26 @@ int32_t beep(void) {
 
 
 int32_t ps(void) {
-    int32_t i;
+    process_crtl_block_t* temp;
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
     printf("\t PID   Terminal#    Status      Command    CreateTime\n");
-    for (i = 0; i < MAX_PROCESS_NUM; i++) {
+    for (temp = process_list; temp != NULL; temp = temp->next) {
         /* only see current active pid */
-        if (process_map[i].status == OCCUPIED) {
-            process_crtl_block_t* temp = get_pcb(i);
+        if (temp->status == OCCUPIED) {
             /* skip current process */
-            if (i == cur_pid) continue;
+            if (temp == cur_pcb) continue;
              /* set the parent to running */
-            if (i == get_cur_pcb()->parent_pid) {
-                printf("\t  %d        %d        running     %s     %s\n", i, process_map[i].terminal_id, &(temp->cmd), &(temp->create_time));
+            if (cur_pcb != NULL && temp->pid == cur_pcb->parent_pid) {
+                printf("\t  %d        %d        running     %s     %s\n", temp->pid, temp->terminal_id, &(temp->cmd), &(temp->create_time));
                 continue;
             }
             /* calculate running time */
             // TODO: calculate run time
             /* print current running and waiting processes */
-            if (process_map[i].is_running == RUNNING) 
-                printf("\t  %d        %d        running     %s     %s\n", i, process_map[i].terminal_id, &(temp->cmd), &(temp->create_time));
+            if (temp->is_running == RUNNING) 
+                printf("\t  %d        %d        running     %s     %s\n", temp->pid, temp->terminal_id, &(temp->cmd), &(temp->create_time));
             else
-                printf("\t  %d        %d        sleeping    %s     %s\n", i, process_map[i].terminal_id, &(temp->cmd), &(temp->create_time));
+                printf("\t  %d        %d        sleeping    %s     %s\n", temp->pid, temp->terminal_id, &(temp->cmd), &(temp->create_time));
         }
     }
     return SUCCESS;
@@ -601,3 +733,570 @@ int32_t random(void)
 {
     return 0;
 }
+
+/*
+ * fork
+ *   DESCRIPTION: duplicate the calling process. The child shares every user
+ *                page copy-on-write and resumes at the same user instruction
+ *                with 0 in eax.
+ *   INPUTS: none
+ *   OUTPUTS: None
+ *   RETURN VALUE: child pid in the parent, 0 in the child, -1 for failure
+ */
+int32_t fork(void)
+{
+    uint32_t flags;
+    int32_t child_pid;
+    sig_regs child_regs;
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    process_crtl_block_t* child_pcb;
+    if (cur_pcb == NULL)
+        return FAILURE;
+
+    cli_and_save(flags);
+    child_pid = allocate_process();
+    if (child_pid == FAILURE){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    child_pcb = clone_PCB(child_pid, cur_pcb);
+    if (child_pcb == NULL){
+        free_process(child_pid);
+        restore_flags(flags);
+        return FAILURE;
+    }
+
+    // the user context int 0x80 saved at the top of our kernel stack
+    child_regs = *(sig_regs*)(cur_pcb->tss_esp0 - sizeof(sig_regs));
+    child_regs.eax = 0;
+    prepare_user_return(child_pcb, &child_regs);
+    child_pcb->is_running = RUNNING;
+    restore_flags(flags);
+    return child_pid;
+}
+
+/*
+ * thread_create
+ *   DESCRIPTION: start a new thread in the calling process. It shares the
+ *                address space and fds and runs on its own user stack.
+ *   INPUTS: entry - user address the thread starts at
+ *           stack - initial user esp, the caller lays out the first frame
+ *   OUTPUTS: None
+ *   RETURN VALUE: thread id for success, -1 for failure
+ */
+int32_t thread_create(void* entry, void* stack)
+{
+    uint32_t flags;
+    int32_t tid;
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    process_crtl_block_t* thread_pcb;
+    if (cur_pcb == NULL || (uint32_t)entry < USER_MEMORY || (uint32_t)entry >= VIRTUAL_MEMORY_END_ADDRESS
+        || (uint32_t)stack <= USER_MEMORY || (uint32_t)stack > VIRTUAL_MEMORY_END_ADDRESS)
+        return FAILURE;
+
+    cli_and_save(flags);
+    tid = allocate_thread(cur_pcb->leader);
+    if (tid == FAILURE){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    thread_pcb = create_thread_PCB(tid, cur_pcb, (uint32_t)entry, (uint32_t)stack);
+    thread_pcb->is_running = RUNNING;
+    restore_flags(flags);
+    return tid;
+}
+
+/*
+ * thread_exit
+ *   DESCRIPTION: end the calling thread, its status goes to thread_join.
+ *                In the main thread this ends the whole process like halt.
+ *   INPUTS: status
+ *   OUTPUTS: None
+ *   RETURN VALUE: never returns for success, -1 for failure
+ */
+int32_t thread_exit(int32_t status)
+{
+    process_crtl_block_t* cur_pcb;
+    cli();
+    cur_pcb = get_cur_pcb();
+    if (cur_pcb == NULL){
+        sti();
+        return FAILURE;
+    }
+    if (cur_pcb->leader == cur_pcb)
+        return halt((uint8_t)status);
+    cur_pcb->exit_status = status;
+    cur_pcb->status = ZOMBIE;
+    cur_pcb->is_running = NOT_RUNNING;
+    if (cur_pcb->join_waiter != NULL)
+        cur_pcb->join_waiter->is_running = RUNNING;
+    process_exit_switch();
+    return FAILURE;
+}
+
+/*
+ * thread_join
+ *   DESCRIPTION: wait for another thread of the calling process to exit and
+ *                free it
+ *   INPUTS: tid - thread id from thread_create
+ *   OUTPUTS: None
+ *   RETURN VALUE: the thread's exit status for success, -1 for failure
+ */
+int32_t thread_join(int32_t tid)
+{
+    uint32_t flags;
+    int32_t ret;
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    process_crtl_block_t* thread_pcb;
+    if (cur_pcb == NULL)
+        return FAILURE;
+
+    cli_and_save(flags);
+    thread_pcb = get_pcb(tid);
+    // only one joiner, and never the main thread or ourselves
+    if (thread_pcb == NULL || thread_pcb == cur_pcb || thread_pcb->leader != cur_pcb->leader
+        || thread_pcb->leader == thread_pcb
+        || (thread_pcb->join_waiter != NULL && thread_pcb->join_waiter != cur_pcb)){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    thread_pcb->join_waiter = cur_pcb;
+    while (thread_pcb->status != ZOMBIE){
+        cur_pcb->is_running = NOT_RUNNING;
+        process_wait();
+    }
+    ret = thread_pcb->exit_status;
+    free_process(tid);
+    restore_flags(flags);
+    return ret;
+}
+
+/*
+ * pipe
+ *   DESCRIPTION: create a pipe, bytes written to fds[1] are read from fds[0]
+ *   INPUTS: fds - user array for the two new fds
+ *   OUTPUTS: fds[0] read end, fds[1] write end
+ *   RETURN VALUE: 0 for success and -1 for failure
+ */
+int32_t pipe(int32_t* fds)
+{
+    int32_t rd, wr;
+    file_desc_entry_t* read_end;
+    file_desc_entry_t* write_end;
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    if (vm_user_writable(cur_pcb, (uint32_t)fds, 2 * sizeof(int32_t)) == FAILURE)
+        return FAILURE;
+    if (pipe_files(&read_end, &write_end) == FAILURE)
+        return FAILURE;
+    rd = fd_install(cur_pcb->fd_table, read_end);
+    if (rd == FAILURE){
+        close_entry(read_end);
+        close_entry(write_end);
+        return FAILURE;
+    }
+    wr = fd_install(cur_pcb->fd_table, write_end);
+    if (wr == FAILURE){
+        close_entry(fd_remove(cur_pcb->fd_table, rd));
+        close_entry(write_end);
+        return FAILURE;
+    }
+    fds[0] = rd;
+    fds[1] = wr;
+    return SUCCESS;
+}
+
+/*
+ * isatty
+ *   DESCRIPTION: tell whether an fd is the terminal, so programs can fall
+ *                back to reading a pipe on stdin
+ *   INPUTS: fd - index to file descriptor array
+ *   OUTPUTS: None
+ *   RETURN VALUE: 1 for the terminal, 0 for anything else, -1 for a bad fd
+ */
+int32_t isatty(int32_t fd)
+{
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    file_desc_entry_t* file;
+    if (cur_pcb == NULL || (file = fd_get(cur_pcb->fd_table, fd)) == NULL)
+        return FAILURE;
+    return (file->file_op.read == terminal_read_intf || file->file_op.write == terminal_write_intf);
+}
+
+/*
+ * spawn
+ *   DESCRIPTION: run a command in the background. Unlike execute the caller
+ *                keeps running, and collects the exit status with waitpid.
+ *   INPUTS: command - program name and argument
+ *   OUTPUTS: None
+ *   RETURN VALUE: pid of the child for success, -1 for failure
+ */
+int32_t spawn(const int8_t* command)
+{
+    uint32_t flags;
+    int32_t child_pid = FAILURE;
+    process_crtl_block_t* child_pcb;
+    if (command == NULL || get_cur_pcb() == NULL)
+        return FAILURE;
+
+    cli_and_save(flags);
+    child_pcb = start_background(command, NULL, NULL);
+    if (child_pcb != NULL)
+        child_pid = child_pcb->pid;
+    restore_flags(flags);
+    return child_pid;
+}
+
+/*
+ * waitpid
+ *   DESCRIPTION: wait for a child started by spawn or fork to halt and free
+ *                it. Children run through execute are not seen here.
+ *   INPUTS: pid - child to wait for, WAIT_ANY for any child
+ *           status - user address for the exit status, may be NULL
+ *           options - WNOHANG to return at once if no child has halted
+ *   OUTPUTS: status - halt status, 256 if the child died by an exception
+ *   RETURN VALUE: pid of the collected child, 0 for WNOHANG with nothing
+ *                 to collect, -1 if there is no such child
+ */
+int32_t waitpid(int32_t pid, int32_t* status, int32_t options)
+{
+    uint32_t flags;
+    int32_t found;
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    process_crtl_block_t* pcb_ptr;
+    if (cur_pcb == NULL || (status != NULL && ((uint32_t)status < USER_MEMORY
+        || (uint32_t)status > VIRTUAL_MEMORY_END_ADDRESS - sizeof(int32_t))))
+        return FAILURE;
+
+    cli_and_save(flags);
+    while (1){
+        found = 0;
+        for (pcb_ptr = process_list; pcb_ptr != NULL; pcb_ptr = pcb_ptr->next){
+            if (pcb_ptr->parent_pid != cur_pcb->pid || pcb_ptr->leader != pcb_ptr || pcb_ptr->parent_waiting)
+                continue;
+            if (pid != WAIT_ANY && pcb_ptr->pid != pid)
+                continue;
+            found = 1;
+            if (pcb_ptr->status == ZOMBIE)
+                break;
+        }
+        if (!found){
+            restore_flags(flags);
+            return FAILURE;
+        }
+        if (pcb_ptr != NULL)
+            break;
+        if (options & WNOHANG){
+            restore_flags(flags);
+            return 0;
+        }
+        // halt wakes the parent's queue after turning into a zombie
+        if (futex_sleep((uint32_t)cur_pcb) != SUCCESS){
+            restore_flags(flags);
+            return FAILURE;
+        }
+    }
+    // the child stays a zombie if its status cannot be stored
+    if (status != NULL && vm_user_writable(cur_pcb, (uint32_t)status, sizeof(int32_t)) == FAILURE){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    pid = pcb_ptr->pid;
+    if (status != NULL)
+        *status = pcb_ptr->exit_status;
+    free_process(pid);
+    restore_flags(flags);
+    return pid;
+}
+
+/*
+ * dup
+ *   DESCRIPTION: give an open file one more fd
+ *   INPUTS: fd - index to file descriptor table
+ *   OUTPUTS: None
+ *   RETURN VALUE: the lowest free fd, which shares the file and its position
+ *                 with fd. -1 for a bad fd or if the table cannot grow.
+ */
+int32_t dup(int32_t fd)
+{
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    file_desc_entry_t* file;
+    int32_t new_fd;
+    if (cur_pcb == NULL || (file = fd_get(cur_pcb->fd_table, fd)) == NULL)
+        return FAILURE;
+    file_get(file);
+    new_fd = fd_install(cur_pcb->fd_table, file);
+    if (new_fd == FAILURE)
+        file_put(file);
+    return new_fd;
+}
+
+/*
+ * dup2
+ *   DESCRIPTION: make newfd refer to the same open file as oldfd, closing
+ *                whatever newfd was first
+ *   INPUTS: oldfd - open fd
+ *           newfd - fd to replace, the table grows to hold it
+ *   OUTPUTS: None
+ *   RETURN VALUE: newfd for success, -1 for a bad fd or if the table cannot
+ *                 grow
+ */
+int32_t dup2(int32_t oldfd, int32_t newfd)
+{
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    file_desc_entry_t* file;
+    if (cur_pcb == NULL || (file = fd_get(cur_pcb->fd_table, oldfd)) == NULL)
+        return FAILURE;
+    if (oldfd == newfd)
+        return newfd;
+    file_get(file);
+    if (fd_set(cur_pcb->fd_table, newfd, file) == FAILURE){
+        file_put(file);
+        return FAILURE;
+    }
+    return newfd;
+}
+
+/*
+ * sendfile
+ *   DESCRIPTION: copy a regular file to another fd without going through
+ *                user memory, the data blocks are handed to the write
+ *                operation of out_fd as they sit in the file system
+ *   INPUTS: out_fd - fd to write, terminal, pipe or anything with a write
+ *           in_fd - fd of a regular file
+ *           offset - user pointer to the position to start at, which is
+ *                    then moved past the bytes sent. NULL to use and move
+ *                    the position of in_fd instead.
+ *           count - most bytes to send
+ *   OUTPUTS: *offset
+ *   RETURN VALUE: bytes sent, 0 at end of file, -1 for bad arguments or if
+ *                 nothing could be written
+ */
+int32_t sendfile(int32_t out_fd, int32_t in_fd, int32_t* offset, int32_t count)
+{
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    file_desc_entry_t* in;
+    file_desc_entry_t* out;
+    const char* data;
+    uint32_t pos;
+    int32_t done = 0, len, ret;
+    if (cur_pcb == NULL || count < 0
+        || (offset != NULL && vm_user_writable(cur_pcb, (uint32_t)offset, sizeof(int32_t)) == FAILURE))
+        return FAILURE;
+    in = fd_get(cur_pcb->fd_table, in_fd);
+    out = fd_get(cur_pcb->fd_table, out_fd);
+    if (in == NULL || out == NULL || in->file_op.read != file_read_intf || out->file_op.write == NULL)
+        return FAILURE;
+    if (offset != NULL && *offset < 0)
+        return FAILURE;
+
+    pos = (offset != NULL) ? (uint32_t)*offset : in->file_pos;
+    while (done < count){
+        len = read_data_block(in->inode, pos, &data);
+        if (len <= 0)
+            break;
+        if (len > count - done)
+            len = count - done;
+        ret = out->file_op.write(out->inode, data, len);
+        if (ret <= 0){
+            // report what already went out, the error shows on the next call
+            if (done == 0)
+                done = FAILURE;
+            break;
+        }
+        done += ret;
+        pos += ret;
+        if (ret < len)
+            break;
+    }
+    if (offset != NULL)
+        *offset = pos;
+    else
+        in->file_pos = pos;
+    return done;
+}
+
+/*
+ * seek_end
+ *   DESCRIPTION: where SEEK_END is for a file that has positions
+ *   INPUTS: file - the open file
+ *   OUTPUTS: None
+ *   RETURN VALUE: file size for a regular file, number of entries for the
+ *                 directory, -1 for pipes and devices that cannot seek
+ */
+static int32_t seek_end(file_desc_entry_t* file)
+{
+    if (file->file_op.read == file_read_intf)
+        return ((inode_blk_t*)fs_start_ptr + 1 + file->inode)->size;
+    if (file->file_op.read == dir_read_intf)
+        return fs_start_ptr->num_dir_entries;
+    return FAILURE;
+}
+
+/*
+ * lseek
+ *   DESCRIPTION: move the position of a regular file or the directory
+ *   INPUTS: fd - index to file descriptor table
+ *           offset - bytes (entries for the directory) to move
+ *           whence - SEEK_SET from the start, SEEK_CUR from the current
+ *                    position or SEEK_END from the end
+ *   OUTPUTS: None
+ *   RETURN VALUE: the new position, -1 for a bad fd or whence, a file that
+ *                 cannot seek or a position before the start. Positions
+ *                 past the end are allowed and read nothing.
+ */
+int32_t lseek(int32_t fd, int32_t offset, int32_t whence)
+{
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    file_desc_entry_t* file;
+    int32_t end, base;
+    if (cur_pcb == NULL || (file = fd_get(cur_pcb->fd_table, fd)) == NULL)
+        return FAILURE;
+    if ((end = seek_end(file)) == FAILURE)
+        return FAILURE;
+    switch (whence){
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = file->file_pos; break;
+        case SEEK_END: base = end; break;
+        default: return FAILURE;
+    }
+    if (base + offset < 0)
+        return FAILURE;
+    file->file_pos = base + offset;
+    return file->file_pos;
+}
+
+/*
+ * pread
+ *   DESCRIPTION: read at a given position, the file position is neither
+ *                used nor moved so threads can share the fd
+ *   INPUTS: fd - index to file descriptor table
+ *           buf - buffer to contain data
+ *           nbytes - most bytes to read
+ *           offset - position to read at
+ *   OUTPUTS: buf
+ *   RETURN VALUE: number of bytes read, -1 for a bad fd or offset or a file
+ *                 that cannot seek
+ */
+int32_t pread(int32_t fd, void* buf, int32_t nbytes, int32_t offset)
+{
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    file_desc_entry_t* file;
+    uint32_t pos = offset;
+    if (cur_pcb == NULL || (file = fd_get(cur_pcb->fd_table, fd)) == NULL || offset < 0)
+        return FAILURE;
+    if (seek_end(file) == FAILURE)
+        return FAILURE;
+    if ((uint32_t)buf >= USER_MEMORY && nbytes > 0
+        && vm_user_writable(cur_pcb, (uint32_t)buf, nbytes) == FAILURE)
+        return FAILURE;
+    return file->file_op.read(file->inode, &pos, buf, nbytes);
+}
+
+/*
+ * gettime_ns
+ *   DESCRIPTION: monotonic time with nanosecond resolution from the TSC
+ *   INPUTS: ns - user pointer to the result
+ *   OUTPUTS: *ns - nanoseconds since boot
+ *   RETURN VALUE: 0 for success and -1 for a bad pointer
+ */
+int32_t gettime_ns(uint64_t* ns)
+{
+    if (vm_user_writable(get_cur_pcb(), (uint32_t)ns, sizeof(uint64_t)) == FAILURE)
+        return FAILURE;
+    *ns = ktime_ns();
+    return SUCCESS;
+}
+
+/*
+ * sleep_wakeup
+ *   DESCRIPTION: timer callback of pcb->sleep_timer, end the sleep
+ *   INPUTS: data - the sleeping pcb
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void sleep_wakeup(uint32_t data)
+{
+    process_crtl_block_t* pcb = (process_crtl_block_t*)data;
+    uint32_t flags;
+    // timers run from a softirq, the rtc interrupt wakes futexes too
+    cli_and_save(flags);
+    futex_wake_key((uint32_t)&pcb->sleep_timer, 1);
+    restore_flags(flags);
+}
+
+/*
+ * sleep_ms
+ *   DESCRIPTION: block the calling thread for a while, other processes run
+ *                until its timer goes off
+ *   INPUTS: ms - milliseconds to sleep, rounded up to whole ticks
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success and -1 for a negative time or if a signal
+ *                 ended the sleep early
+ */
+int32_t sleep_ms(int32_t ms)
+{
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    uint32_t flags;
+    if (cur_pcb == NULL || ms < 0)
+        return FAILURE;
+    if (ms == 0)
+        return SUCCESS;
+    cli_and_save(flags);
+    init_timer(&cur_pcb->sleep_timer, sleep_wakeup, (uint32_t)cur_pcb);
+    add_timer(&cur_pcb->sleep_timer, timer_ticks + ms_to_ticks(ms));
+    if (futex_sleep((uint32_t)&cur_pcb->sleep_timer) != SUCCESS){
+        del_timer(&cur_pcb->sleep_timer);
+        restore_flags(flags);
+        return FAILURE;
+    }
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ * alarm
+ *   DESCRIPTION: raise ALARM once after ms, replacing the alarm already set
+ *                (the periodic one every process starts with, too)
+ *   INPUTS: ms - milliseconds until the alarm, 0 only cancels
+ *   OUTPUTS: none
+ *   RETURN VALUE: milliseconds that were left on the old alarm, 0 if none
+ *                 was pending, -1 for a negative time
+ */
+int32_t alarm(int32_t ms)
+{
+    process_crtl_block_t* cur_pcb = get_cur_pcb();
+    uint32_t flags;
+    int32_t left = 0;
+    if (cur_pcb == NULL || ms < 0)
+        return FAILURE;
+    cli_and_save(flags);
+    if (del_timer(&cur_pcb->alarm_timer))
+        left = (cur_pcb->alarm_timer.expires - timer_ticks) * MSEC_PER_TICK;
+    cur_pcb->alarm_period = 0;
+    if (ms != 0)
+        add_timer(&cur_pcb->alarm_timer, timer_ticks + ms_to_ticks(ms));
+    restore_flags(flags);
+    return left;
+}
+
+/*
+ * irqstat
+ *   DESCRIPTION: copy out how many interrupts each irq has taken since boot
+ *   INPUTS: counts - user array, one entry per irq
+ *           n - entries in counts
+ *   OUTPUTS: counts[0..] - interrupts of irq 0, 1, ...
+ *   RETURN VALUE: number of entries filled and -1 for a bad array
+ */
+int32_t irqstat(uint32_t* counts, int32_t n)
+{
+    int32_t i;
+    if (n < 0)
+        return FAILURE;
+    if (n > NUM_IRQ)
+        n = NUM_IRQ;
+    if (vm_user_writable(get_cur_pcb(), (uint32_t)counts, n * sizeof(uint32_t)) == FAILURE)
+        return FAILURE;
+    for (i = 0; i < n; i++)
+        counts[i] = irq_count[i];
+    return n;
+}
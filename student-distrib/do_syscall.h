@@ -5,12 +5,18 @@
 #include "filesystem/filesys.h"
 
 #define EXCEPTION_HANDLER 256
-#define MAX_FDA           8
-#define MIN_FDA           0
-#define EXECTURE_BUF_SIZE 4
 
 #define USR_VIDMEM_ADDR 0x10000000
 
+/* waitpid */
+#define WAIT_ANY          -1
+#define WNOHANG           1
+
+/* lseek */
+#define SEEK_SET          0
+#define SEEK_CUR          1
+#define SEEK_END          2
+
 extern file_ops_table_t empty_op;
 
 int32_t halt (uint8_t status);
@@ -27,5 +33,23 @@ int32_t new_poke(uint32_t pos, uint32_t data);
 int32_t beep(void);
 int32_t ps(void);
 int32_t random(void);
+int32_t fork(void);
+int32_t thread_create(void* entry, void* stack);
+int32_t thread_exit(int32_t status);
+int32_t thread_join(int32_t tid);
+int32_t pipe(int32_t* fds);
+int32_t isatty(int32_t fd);
+int32_t spawn(const int8_t* command);
+int32_t waitpid(int32_t pid, int32_t* status, int32_t options);
+int32_t dup(int32_t fd);
+int32_t dup2(int32_t oldfd, int32_t newfd);
+int32_t sendfile(int32_t out_fd, int32_t in_fd, int32_t* offset, int32_t count);
+int32_t lseek(int32_t fd, int32_t offset, int32_t whence);
+int32_t pread(int32_t fd, void* buf, int32_t nbytes, int32_t offset);
+int32_t gettime_ns(uint64_t* ns);
+int32_t sleep_ms(int32_t ms);
+int32_t alarm(int32_t ms);
+int32_t irqstat(uint32_t* counts, int32_t n);
+int32_t sigprocmask(int32_t how, const uint32_t* set, uint32_t* oldset);
 
 #endif
@@ -0,0 +1,109 @@
+#include "elf.h"
+#include "lib.h"
+#include "filesystem/filesys.h"
+#include "memory/frame.h"
+#include "memory/vm.h"
+#include "memory/image.h"
+
+static int32_t elf_load_segment(uint32_t inode, uint32_t size, pte_desc_t* user_pt, elf_phdr_t* phdr);
+
+/*
+ * elf_check
+ *   DESCRIPTION: check that a file is a 32 bit x86 executable we can load
+ *   INPUTS: inode - inode of the file
+ *           size - file size in bytes
+ *   OUTPUTS: header - the ELF header of the file
+ *   RETURN VALUE: 0 for success and -1 for failure
+ */
+int32_t elf_check(uint32_t inode, uint32_t size, elf_header_t* header){
+    if (size < sizeof(elf_header_t)
+        || read_data(inode, 0, (char*)header, sizeof(elf_header_t)) != (int32_t)sizeof(elf_header_t))
+        return FAILURE;
+    if (header->magic != ELF_MAGIC || header->class != ELF_CLASS_32 || header->data != ELF_DATA_LSB
+        || header->type != ELF_TYPE_EXEC || header->machine != ELF_MACHINE_386)
+        return FAILURE;
+    if (header->phentsize != sizeof(elf_phdr_t) || header->phnum == 0 || header->phnum > ELF_MAX_PHDR
+        || header->phoff > size || header->phnum * sizeof(elf_phdr_t) > size - header->phoff)
+        return FAILURE;
+    return SUCCESS;
+}
+
+/*
+ * elf_load
+ *   DESCRIPTION: map the PT_LOAD segments of an executable. File contents
+ *                are shared with other instances of the program, bss is
+ *                left to the page fault handler to fill with zero pages.
+ *   INPUTS: inode - inode of the program file
+ *           size - file size in bytes
+ *           user_pt - page table of the new address space, must be live
+ *   OUTPUTS: entry - the program entry point
+ *            end - first address past every segment, the heap goes there
+ *   RETURN VALUE: 0 for success and -1 for failure
+ *   SIDE EFFECTS: segments mapped before a failure stay, the caller frees
+ *                 the whole address space
+ */
+int32_t elf_load(uint32_t inode, uint32_t size, pte_desc_t* user_pt, uint32_t* entry, uint32_t* end){
+    elf_header_t header;
+    elf_phdr_t phdrs[ELF_MAX_PHDR];
+    uint32_t i, len;
+
+    *end = USER_SPACE_BEGIN;
+    if (elf_check(inode, size, &header) == FAILURE)
+        return FAILURE;
+    len = header.phnum * sizeof(elf_phdr_t);
+    if (read_data(inode, header.phoff, (char*)phdrs, len) != (int32_t)len)
+        return FAILURE;
+    for (i = 0; i < header.phnum; i++){
+        if (phdrs[i].type != PT_LOAD || phdrs[i].memsz == 0)
+            continue;
+        if (elf_load_segment(inode, size, user_pt, &phdrs[i]) == FAILURE)
+            return FAILURE;
+        if (phdrs[i].vaddr + phdrs[i].memsz > *end)
+            *end = phdrs[i].vaddr + phdrs[i].memsz;
+    }
+    *entry = header.entry;
+    return SUCCESS;
+}
+
+/*
+ * elf_load_segment
+ *   DESCRIPTION: map one PT_LOAD segment. Whole pages of file data come from
+ *                the image cache, the page where file data ends and bss
+ *                begins gets a private copy with the bss part zeroed.
+ *   INPUTS: inode - inode of the program file
+ *           size - file size in bytes
+ *           user_pt - page table of the new address space, must be live
+ *           phdr - the segment
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success and -1 for failure
+ */
+static int32_t elf_load_segment(uint32_t inode, uint32_t size, pte_desc_t* user_pt, elf_phdr_t* phdr){
+    uint32_t file_end, shared_end, copy_start;
+    int32_t writable = (phdr->flags & PF_W) ? 1 : 0;
+
+    if (phdr->vaddr < USER_SPACE_BEGIN || phdr->vaddr >= USER_SPACE_END
+        || phdr->memsz > USER_SPACE_END - phdr->vaddr || phdr->filesz > phdr->memsz
+        || phdr->offset > size || phdr->filesz > size - phdr->offset
+        || ((phdr->offset ^ phdr->vaddr) & (FRAME_SIZE - 1)))
+        return FAILURE;
+    file_end = phdr->vaddr + phdr->filesz;
+    // without bss the file bytes after the segment are harmless, share the
+    // last page too
+    shared_end = (phdr->memsz > phdr->filesz) ? (file_end & ~(FRAME_SIZE - 1)) : file_end;
+
+    if (shared_end > phdr->vaddr){
+        if (image_map(user_pt, inode, size, phdr->offset, phdr->vaddr, shared_end - phdr->vaddr, writable) == FAILURE){
+            // too large to cache, a private copy of the file data
+            if (vm_map_zero(user_pt, phdr->vaddr, shared_end - phdr->vaddr) == FAILURE)
+                return FAILURE;
+            read_data(inode, phdr->offset, (char*)phdr->vaddr, shared_end - phdr->vaddr);
+        }
+    }
+    if (shared_end < file_end){
+        copy_start = (shared_end > phdr->vaddr) ? shared_end : phdr->vaddr;
+        if (vm_map_zero(user_pt, copy_start, file_end - copy_start) == FAILURE)
+            return FAILURE;
+        read_data(inode, phdr->offset + (copy_start - phdr->vaddr), (char*)copy_start, file_end - copy_start);
+    }
+    return SUCCESS;
+}
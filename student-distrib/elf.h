@@ -0,0 +1,56 @@
+#ifndef _ELF_H
+#define _ELF_H
+
+#include "types.h"
+#include "x86_desc.h"
+
+#define ELF_MAGIC       0x464C457F      /* "\177ELF" read as a little endian word */
+#define ELF_CLASS_32    1
+#define ELF_DATA_LSB    1
+#define ELF_TYPE_EXEC   2
+#define ELF_MACHINE_386 3
+
+/* program header type and flags */
+#define PT_LOAD         1
+#define PF_X            0x1
+#define PF_W            0x2
+#define PF_R            0x4
+
+#define ELF_MAX_PHDR    16
+
+typedef struct elf_header {
+    uint32_t magic;
+    uint8_t class;
+    uint8_t data;
+    uint8_t ident_version;
+    uint8_t ident_pad[9];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;
+    uint32_t phoff;
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} __attribute__((packed)) elf_header_t;
+
+typedef struct elf_phdr {
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+} __attribute__((packed)) elf_phdr_t;
+
+int32_t elf_check(uint32_t inode, uint32_t size, elf_header_t* header);
+int32_t elf_load(uint32_t inode, uint32_t size, pte_desc_t* user_pt, uint32_t* entry, uint32_t* end);
+
+#endif /* _ELF_H */
@@ -0,0 +1,281 @@
+#include "file.h"
+#include "../lib.h"
+#include "../process_crtl.h"
+#include "../memory/slab.h"
+
+static kmem_cache_t file_cache;
+
+static int32_t fd_table_grow(fd_table_t* table, int32_t min_size);
+static uint32_t first_zero_bit(uint32_t word);
+
+/*
+ * file_init
+ *   DESCRIPTION: set up the cache open files are allocated from
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void file_init(void){
+    kmem_cache_init(&file_cache, "file", sizeof(file_desc_entry_t), NULL);
+}
+
+/*
+ * file_alloc
+ *   DESCRIPTION: make a new open file with no operations yet
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the file holding one reference, NULL if out of memory
+ */
+file_desc_entry_t* file_alloc(void){
+    file_desc_entry_t* file = kmem_cache_alloc(&file_cache);
+    if (file == NULL)
+        return NULL;
+    memset(file, 0, sizeof(file_desc_entry_t));
+    file->flags = FILE_FLAG_IN_USE;
+    file->refcount = 1;
+    return file;
+}
+
+/*
+ * file_get
+ *   DESCRIPTION: take one more reference on an open file
+ *   INPUTS: file - the file
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void file_get(file_desc_entry_t* file){
+    uint32_t flags;
+    cli_and_save(flags);
+    file->refcount++;
+    restore_flags(flags);
+}
+
+/*
+ * file_put
+ *   DESCRIPTION: drop a reference, the last one closes and frees the file
+ *   INPUTS: file - the file
+ *   OUTPUTS: none
+ *   RETURN VALUE: result of the close operation, 0 if the file stays open
+ */
+int32_t file_put(file_desc_entry_t* file){
+    uint32_t flags;
+    int32_t ret = SUCCESS;
+    cli_and_save(flags);
+    if (--file->refcount == 0){
+        if (file->file_op.close != NULL)
+            ret = file->file_op.close(&(file->inode));
+        kmem_cache_free(&file_cache, file);
+    }
+    restore_flags(flags);
+    return ret;
+}
+
+/*
+ * fd_table_init
+ *   DESCRIPTION: start an empty table in its inline slots
+ *   INPUTS: table - the table
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void fd_table_init(fd_table_t* table){
+    table->size = FD_INLINE;
+    table->order = FAILURE;
+    table->files = table->inline_files;
+    table->used = table->inline_used;
+    memset(table->inline_files, 0, sizeof(table->inline_files));
+    memset(table->inline_used, 0, sizeof(table->inline_used));
+}
+
+/*
+ * fd_table_copy
+ *   DESCRIPTION: give a new table the same fds as another one, for fork.
+ *                Both share the open files and their positions.
+ *   INPUTS: dst - table from fd_table_init
+ *           src - table to copy
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 if out of memory
+ */
+int32_t fd_table_copy(fd_table_t* dst, fd_table_t* src){
+    uint32_t flags;
+    int32_t fd;
+    cli_and_save(flags);
+    if (src->size > dst->size && fd_table_grow(dst, src->size) == FAILURE){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    for (fd = 0; fd < src->size; fd++){
+        if (src->files[fd] == NULL)
+            continue;
+        dst->files[fd] = src->files[fd];
+        dst->files[fd]->refcount++;
+    }
+    memcpy(dst->used, src->used, ((src->size + 31) / 32) * sizeof(uint32_t));
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ * fd_table_destroy
+ *   DESCRIPTION: close every fd and go back to the inline slots
+ *   INPUTS: table - the table
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: may be called again on the emptied table
+ */
+void fd_table_destroy(fd_table_t* table){
+    uint32_t flags;
+    int32_t fd;
+    file_desc_entry_t* file;
+    cli_and_save(flags);
+    for (fd = 0; fd < table->size; fd++){
+        if ((file = fd_remove(table, fd)) != NULL)
+            file_put(file);
+    }
+    if (table->order != FAILURE)
+        free_pages((uint32_t)table->files, table->order);
+    fd_table_init(table);
+    restore_flags(flags);
+}
+
+/*
+ * fd_install
+ *   DESCRIPTION: put a file in the lowest free fd, growing the table if
+ *                every slot is taken
+ *   INPUTS: table - the table
+ *           file - the file, the table takes over the caller's reference
+ *   OUTPUTS: none
+ *   RETURN VALUE: the fd, -1 if the table cannot grow
+ */
+int32_t fd_install(fd_table_t* table, file_desc_entry_t* file){
+    uint32_t flags;
+    int32_t word, fd = FAILURE;
+    cli_and_save(flags);
+    for (word = 0; word < (table->size + 31) / 32; word++){
+        if (table->used[word] == 0xFFFFFFFF)
+            continue;
+        fd = word * 32 + first_zero_bit(table->used[word]);
+        break;
+    }
+    // the inline bitmap word has bits past the table size
+    if (fd == FAILURE || fd >= table->size){
+        fd = table->size;
+        if (fd_table_grow(table, fd + 1) == FAILURE){
+            restore_flags(flags);
+            return FAILURE;
+        }
+    }
+    table->files[fd] = file;
+    table->used[fd / 32] |= 1 << (fd % 32);
+    restore_flags(flags);
+    return fd;
+}
+
+/*
+ * fd_set
+ *   DESCRIPTION: put a file in a given fd, closing what was there
+ *   INPUTS: table - the table
+ *           fd - the fd, the table grows to hold it
+ *           file - the file, the table takes over the caller's reference
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 for a bad fd or if out of memory
+ */
+int32_t fd_set(fd_table_t* table, int32_t fd, file_desc_entry_t* file){
+    uint32_t flags;
+    file_desc_entry_t* old;
+    if (fd < 0 || fd >= FD_MAX)
+        return FAILURE;
+    cli_and_save(flags);
+    if (fd >= table->size && fd_table_grow(table, fd + 1) == FAILURE){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    old = table->files[fd];
+    table->files[fd] = file;
+    table->used[fd / 32] |= 1 << (fd % 32);
+    if (old != NULL)
+        file_put(old);
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ * fd_get
+ *   DESCRIPTION: look up the file behind an fd
+ *   INPUTS: table - the table
+ *           fd - the fd
+ *   OUTPUTS: none
+ *   RETURN VALUE: the file, NULL if the fd is not open
+ */
+file_desc_entry_t* fd_get(fd_table_t* table, int32_t fd){
+    if (table == NULL || fd < 0 || fd >= table->size)
+        return NULL;
+    return table->files[fd];
+}
+
+/*
+ * fd_remove
+ *   DESCRIPTION: free an fd
+ *   INPUTS: table - the table
+ *           fd - the fd
+ *   OUTPUTS: none
+ *   RETURN VALUE: the file it held, the caller owns that reference. NULL if
+ *                 the fd was not open.
+ */
+file_desc_entry_t* fd_remove(fd_table_t* table, int32_t fd){
+    uint32_t flags;
+    file_desc_entry_t* file;
+    if (table == NULL || fd < 0 || fd >= table->size)
+        return NULL;
+    cli_and_save(flags);
+    file = table->files[fd];
+    table->files[fd] = NULL;
+    table->used[fd / 32] &= ~(1 << (fd % 32));
+    restore_flags(flags);
+    return file;
+}
+
+/*
+ * fd_table_grow
+ *   DESCRIPTION: move a table to a buddy block that holds min_size fds
+ *   INPUTS: table - the table
+ *           min_size - fds needed
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 if too large or out of memory
+ *   SIDE EFFECTS: call with interrupts off
+ */
+static int32_t fd_table_grow(fd_table_t* table, int32_t min_size){
+    int32_t order = table->order + 1;
+    int32_t capacity;
+    uint32_t block;
+    while (order <= FD_TABLE_MAX_ORDER && FD_TABLE_CAPACITY(order) < min_size)
+        order++;
+    if (order > FD_TABLE_MAX_ORDER)
+        return FAILURE;
+    block = alloc_pages(order);
+    if (block == 0)
+        return FAILURE;
+    capacity = FD_TABLE_CAPACITY(order);
+    memset((void*)block, 0, FRAME_SIZE << order);
+    memcpy((void*)block, table->files, table->size * sizeof(file_desc_entry_t*));
+    memcpy((uint32_t*)block + capacity, table->used, ((table->size + 31) / 32) * sizeof(uint32_t));
+    if (table->order != FAILURE)
+        free_pages((uint32_t)table->files, table->order);
+    table->files = (file_desc_entry_t**)block;
+    table->used = (uint32_t*)block + capacity;
+    table->size = capacity;
+    table->order = order;
+    return SUCCESS;
+}
+
+/*
+ * first_zero_bit
+ *   DESCRIPTION: index of the lowest clear bit, one bsf
+ *   INPUTS: word - a word with at least one clear bit
+ *   OUTPUTS: none
+ *   RETURN VALUE: the bit index
+ */
+static uint32_t first_zero_bit(uint32_t word){
+    uint32_t bit;
+    asm volatile ("bsfl %1, %0" : "=r"(bit) : "rm"(~word) : "cc");
+    return bit;
+}
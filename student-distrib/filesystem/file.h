@@ -0,0 +1,40 @@
+#ifndef _FILE_H
+#define _FILE_H
+
+#include "../types.h"
+#include "filesys.h"
+#include "../memory/frame.h"
+
+/* a new table holds FD_INLINE fds in the pcb, it then moves to buddy blocks
+ * of up to FD_TABLE_MAX_ORDER, each holding the file pointers followed by
+ * the bitmap of used slots */
+#define FD_INLINE               8
+#define FD_TABLE_MAX_ORDER      4
+#define FD_TABLE_CAPACITY(order) ((((FRAME_SIZE << (order)) * 8) / 33) & ~31)
+#define FD_MAX                  FD_TABLE_CAPACITY(FD_TABLE_MAX_ORDER)
+
+typedef struct fd_table {
+    int32_t size;
+    // buddy order of the storage, -1 while the inline arrays are used
+    int32_t order;
+    file_desc_entry_t** files;
+    uint32_t* used;
+    file_desc_entry_t* inline_files[FD_INLINE];
+    uint32_t inline_used[(FD_INLINE + 31) / 32];
+} fd_table_t;
+
+void file_init(void);
+file_desc_entry_t* file_alloc(void);
+void file_get(file_desc_entry_t* file);
+int32_t file_put(file_desc_entry_t* file);
+
+void fd_table_init(fd_table_t* table);
+int32_t fd_table_copy(fd_table_t* dst, fd_table_t* src);
+void fd_table_destroy(fd_table_t* table);
+
+int32_t fd_install(fd_table_t* table, file_desc_entry_t* file);
+int32_t fd_set(fd_table_t* table, int32_t fd, file_desc_entry_t* file);
+file_desc_entry_t* fd_get(fd_table_t* table, int32_t fd);
+file_desc_entry_t* fd_remove(fd_table_t* table, int32_t fd);
+
+#endif /* _FILE_H */
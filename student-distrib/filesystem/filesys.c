@@ -404,5 +404,27 @@ int32_t read_data(uint32_t inode, uint32_t offset, char* buf, uint32_t length) {
     return nbytes;
 }
 
+/*
+ * read_data_block
+ *   DESCRIPTION: point at file data in place instead of copying it, the
+ *                file system image stays mapped in the kernel
+ *   INPUTS: inode - index of the inode to read from
+ *           offset - the starting reading point in the inode
+ *   OUTPUTS: data - start of the bytes at offset
+ *   RETURN VALUE: number of bytes from offset to the end of its data block or
+ *                 of the file, 0 at end of file, FAILURE(-1) for a bad inode
+ */
+int32_t read_data_block(uint32_t inode, uint32_t offset, const char** data) {
+    if (fs_start_ptr == NULL || data == NULL || inode >= fs_start_ptr -> num_inodes) return FAILURE;
+    inode_blk_t* inode_blk = (inode_blk_t*) fs_start_ptr + 1 + inode;
+    if (offset >= inode_blk->size) return 0;
+    data_blk_t* curr_blk = (data_blk_t*) fs_start_ptr + fs_start_ptr -> num_inodes + inode_blk->data[offset / FS_BLK_SIZE] + 1;
+    uint32_t begin = offset % FS_BLK_SIZE;
+    *data = (const char*) curr_blk + begin;
+    if (inode_blk->size - offset < FS_BLK_SIZE - begin)
+        return inode_blk->size - offset;
+    return FS_BLK_SIZE - begin;
+}
+
 
 
@@ -67,6 +67,7 @@ int32_t file_read_intf(int32_t inode, uint32_t* offset, void* buf, int32_t nbyte
 int32_t read_dentry_by_name(const char* fname, dentry_t* dentry);
 int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry);
 int32_t read_data(uint32_t inode, uint32_t offset, char* buf, uint32_t length);
+int32_t read_data_block(uint32_t inode, uint32_t offset, const char** data);
 
 /* define global variables */
 extern boot_blk_t* fs_start_ptr;
@@ -87,11 +88,14 @@ typedef struct{
 #define FILE_FLAG_IN_USE    1
 #define FILE_FLAG_FREE      0
 
+/* an open file, shared by every fd that refers to it (dup, fork) */
 typedef struct {
     file_ops_table_t file_op;
     int32_t inode;
     uint32_t file_pos;
     int32_t flags;
+    // fds and other holders, the file is closed with the last one
+    int32_t refcount;
 } file_desc_entry_t;
 
 extern file_ops_table_t operation_set[FILE_TYPE_NUM];
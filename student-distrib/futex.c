@@ -0,0 +1,159 @@
+#include "futex.h"
+#include "lib.h"
+#include "memory/vm.h"
+#include "signal.h"
+
+// wait queues are keyed by the physical address of the futex word, so
+// threads and processes sharing the page meet in the same queue. Kernel
+// objects are identity mapped and sleep on their own address the same way.
+#define FUTEX_HASH(key)     (((key) >> 2) & (FUTEX_HASH_SIZE - 1))
+
+static process_crtl_block_t* futex_hash[FUTEX_HASH_SIZE];
+
+static uint32_t futex_get_key(int32_t* uaddr);
+
+/*
+ * futex_get_key
+ *   DESCRIPTION: turn a user futex address into its wait queue key
+ *   INPUTS: uaddr - user address of the futex word
+ *   OUTPUTS: none
+ *   RETURN VALUE: physical address of the word, 0 if it is not valid
+ */
+static uint32_t futex_get_key(int32_t* uaddr){
+    process_crtl_block_t* pcb = get_cur_pcb();
+    if (pcb == NULL || ((uint32_t)uaddr & (sizeof(int32_t) - 1)))
+        return 0;
+    return vm_user_phys(pcb, (uint32_t)uaddr);
+}
+
+/*
+ * futex_wait
+ *   DESCRIPTION: sleep until futex_wake on uaddr, but only if it still
+ *                holds the expected value
+ *   INPUTS: uaddr - user address of the futex word
+ *           expected - value the caller last saw in it
+ *   OUTPUTS: None
+ *   RETURN VALUE: 0 after a wake up, -1 if the value changed, the address
+ *                 is bad or a signal ended the sleep
+ */
+int32_t futex_wait(int32_t* uaddr, int32_t expected)
+{
+    uint32_t flags, key;
+    process_crtl_block_t* pcb = get_cur_pcb();
+    if (pcb == NULL)
+        return FAILURE;
+
+    // the check and the enqueue can't be split by a futex_wake
+    cli_and_save(flags);
+    key = futex_get_key(uaddr);
+    if (key == 0 || *uaddr != expected){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    if (futex_sleep(key) != SUCCESS){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ * futex_wake
+ *   DESCRIPTION: wake threads sleeping in futex_wait on uaddr
+ *   INPUTS: uaddr - user address of the futex word
+ *           n - most threads to wake
+ *   OUTPUTS: None
+ *   RETURN VALUE: number of threads woken, -1 if the address is bad
+ */
+int32_t futex_wake(int32_t* uaddr, int32_t n)
+{
+    uint32_t flags, key;
+    int32_t woken;
+
+    cli_and_save(flags);
+    key = futex_get_key(uaddr);
+    if (key == 0){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    woken = futex_wake_key(key, n);
+    restore_flags(flags);
+    return woken;
+}
+
+/*
+ * futex_sleep
+ *   DESCRIPTION: put the current process on a wait queue and sleep until
+ *                futex_wake_key takes it off, or a signal that is not
+ *                blocked or ignored arrives
+ *   INPUTS: key - physical address to wait on
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 after a wake up, -1 if a signal ended the sleep and
+ *                 the caller has to return to user mode to take it
+ *   SIDE EFFECTS: call with interrupts off, right after checking the
+ *                 condition, and check it again afterwards
+ */
+int32_t futex_sleep(uint32_t key){
+    process_crtl_block_t* pcb = get_cur_pcb();
+    pcb->futex_key = key;
+    pcb->futex_next = futex_hash[FUTEX_HASH(key)];
+    futex_hash[FUTEX_HASH(key)] = pcb;
+    // futex_wake_key clears the key when it takes us off the queue
+    while (pcb->futex_key != 0){
+        if (signal_interrupts_sleep(pcb)){
+            futex_cancel(pcb);
+            return FAILURE;
+        }
+        pcb->is_running = NOT_RUNNING;
+        process_wait();
+    }
+    return SUCCESS;
+}
+
+/*
+ * futex_wake_key
+ *   DESCRIPTION: wake processes sleeping on a wait queue
+ *   INPUTS: key - physical address they wait on
+ *           n - most processes to wake
+ *   OUTPUTS: none
+ *   RETURN VALUE: number of processes woken
+ *   SIDE EFFECTS: call with interrupts off
+ */
+int32_t futex_wake_key(uint32_t key, int32_t n){
+    int32_t woken = 0;
+    process_crtl_block_t** link = &futex_hash[FUTEX_HASH(key)];
+    process_crtl_block_t* pcb;
+    while (*link != NULL && woken < n){
+        pcb = *link;
+        if (pcb->futex_key != key){
+            link = &pcb->futex_next;
+            continue;
+        }
+        *link = pcb->futex_next;
+        pcb->futex_key = 0;
+        pcb->is_running = RUNNING;
+        woken++;
+    }
+    return woken;
+}
+
+/*
+ * futex_cancel
+ *   DESCRIPTION: take a pcb off its futex wait queue
+ *   INPUTS: pcb - process or thread about to be freed
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void futex_cancel(process_crtl_block_t* pcb){
+    process_crtl_block_t** link;
+    if (pcb->futex_key == 0)
+        return;
+    for (link = &futex_hash[FUTEX_HASH(pcb->futex_key)]; *link != NULL; link = &(*link)->futex_next){
+        if (*link == pcb){
+            *link = pcb->futex_next;
+            break;
+        }
+    }
+    pcb->futex_key = 0;
+}
@@ -0,0 +1,18 @@
+#ifndef _FUTEX_H
+#define _FUTEX_H
+
+#include "types.h"
+#include "process_crtl.h"
+
+#define FUTEX_HASH_SIZE     64
+
+int32_t futex_wait(int32_t* uaddr, int32_t expected);
+int32_t futex_wake(int32_t* uaddr, int32_t n);
+
+/* in-kernel wait queues, interrupts must be off */
+int32_t futex_sleep(uint32_t key);
+int32_t futex_wake_key(uint32_t key, int32_t n);
+
+void futex_cancel(process_crtl_block_t* pcb);
+
+#endif /* _FUTEX_H */
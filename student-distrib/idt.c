@@ -21,6 +21,12 @@
 
 #define SYSTEM_CALL_VEC 0x80        // System call vector index
 
+/* sysenter MSRs, and the CPUID.1:EDX bit saying they exist */
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+#define CPUID_SEP        0x800
+
 #define NMI_VEC         0x02        //NMI interrupt vector index
 
 //handler function
@@ -127,6 +133,28 @@ void init_idt()
 
 }
 
+/*
+ * init_sysenter
+ *   DESCRIPTION: enable the sysenter/sysexit fast system call path next to
+ *                int $0x80. sysenter_entry takes the kernel stack from the
+ *                tss, so the MSR stack only has to be valid memory.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if sysenter is set up, 0 if the cpu has no sysenter
+ */
+int32_t init_sysenter()
+{
+    static uint32_t entry_stack[4];
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    if (!(edx & CPUID_SEP))
+        return 0;
+    asm volatile ("wrmsr" : : "c"(MSR_SYSENTER_CS), "a"(KERNEL_CS), "d"(0));
+    asm volatile ("wrmsr" : : "c"(MSR_SYSENTER_ESP), "a"((uint32_t)&entry_stack[4]), "d"(0));
+    asm volatile ("wrmsr" : : "c"(MSR_SYSENTER_EIP), "a"((uint32_t)sysenter_entry), "d"(0));
+    return 1;
+}
+
 void excep_signal_raise(sig_regs r){
     if(r.num == 0){
         signal_raise(0);
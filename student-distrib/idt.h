@@ -7,6 +7,7 @@
 // init idt function
 #define MAGIC_HALT 0x0F
 extern void init_idt();
+extern int32_t init_sysenter();
 extern int32_t halt_flag;
 
 #endif
@@ -16,6 +16,7 @@
 #include "devices/cursor.h"
 #include "do_syscall.h"
 #include "devices/pit.h"
+#include "devices/tsc.h"
 #include "terminal.h"
 #include "vga_design.h"
 #include "status_bar.h"
@@ -24,6 +25,11 @@
 #include "cursor_graphic.h"
 #include "devices/mouse.h"
 #include "mouse_graphic.h"
+#include "memory/frame.h"
+#include "memory/slab.h"
+#include "pipe.h"
+#include "filesystem/file.h"
+#include "timer.h"
 
 #define RUN_TESTS
 
@@ -169,6 +175,7 @@ void entry(unsigned long magic, unsigned long addr) {
     i8259_init();
     /* Init the idt */
     init_idt();
+    init_sysenter();
     
     /* Initialize devices, memory, filesystem, enable device interrupts on the
      * PIC, any other initialization stuff... */
@@ -178,6 +185,15 @@ void entry(unsigned long magic, unsigned long addr) {
     init_keyboard();
     /* init VGA*/
     pci_init(); //work for VGA
+    /* physical frames for pcbs, kernel stacks and user images */
+    frame_init(mbi);
+    printf("frames: %u free, %u used (4KB each)\n", frame_free_count(), frame_used_count());
+    /* object caches on top of the frames */
+    kmem_init();
+    pipe_init();
+    file_init();
+    /* clock page shared with every process */
+    time_init();
     /* paging */    
     qemu_vga_init(QEMU_VGA_DEFAULT_WIDTH, QEMU_VGA_DEFAULT_HEIGHT, QEMU_VGA_DEFAULT_BPP);
     init_paging();
@@ -186,6 +202,8 @@ void entry(unsigned long magic, unsigned long addr) {
     /* initialize multi-process scheduling */
     multi_terminal_init();
     pit_init();
+    /* nanosecond clock, timed against the PIT */
+    tsc_init();
     /* ready to go! */
     // init history buffer
     init_history_list();
@@ -196,6 +214,9 @@ void entry(unsigned long magic, unsigned long addr) {
     animation();
     char startw[] = "This is our OS!";
     message_update_for_sb(startw, strlen(startw), PARM_BLACK_ON_WHITE);
+    /* cursor blink and the status bar clock run on kernel timers */
+    graphic_cursor_blink_start();
+    clock_start_for_sb();
 
     draw_terminal_icon();
     graphic_mouse_init();
@@ -0,0 +1,234 @@
+#include "ktimer.h"
+#include "lib.h"
+
+volatile uint32_t timer_ticks = 0;
+
+// next tick the wheel has to run, behind timer_ticks until SOFTIRQ_TIMER
+// catches up
+static uint32_t wheel_ticks = 0;
+static ktimer_t* tv1[TVR_SIZE];
+static ktimer_t* tvn[TVN_LEVELS][TVN_SIZE];
+
+// slot of level n that covers the tick
+#define TVN_INDEX(tick, n)  (((tick) >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+static void internal_add_timer(ktimer_t* timer);
+static int32_t cascade(int32_t level, int32_t index);
+
+/*
+ * internal_add_timer
+ *   DESCRIPTION: hang a timer in the slot for its expiry, relative to the
+ *                tick the wheel runs next
+ *   INPUTS: timer - timer to add, not pending
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: call with interrupts off
+ */
+static void internal_add_timer(ktimer_t* timer){
+    uint32_t idx = timer->expires - wheel_ticks;
+    ktimer_t** slot;
+    int32_t level;
+    if ((int32_t)idx < 0){
+        // already due, run it on the next tick
+        slot = &tv1[wheel_ticks & TVR_MASK];
+    } else if (idx < TVR_SIZE){
+        slot = &tv1[timer->expires & TVR_MASK];
+    } else {
+        // the last level takes whatever is left of the 32 bit range
+        for (level = 0; level < TVN_LEVELS - 1; level++){
+            if (idx < 1U << (TVR_BITS + (level + 1) * TVN_BITS))
+                break;
+        }
+        slot = &tvn[level][TVN_INDEX(timer->expires, level)];
+    }
+    timer->next = *slot;
+    if (timer->next != NULL)
+        timer->next->pprev = &timer->next;
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+/*
+ * cascade
+ *   DESCRIPTION: empty one slot of an upper level, its timers now fall into
+ *                the levels below
+ *   INPUTS: level - upper level, 0 is the one right above tv1
+ *           index - slot to empty
+ *   OUTPUTS: none
+ *   RETURN VALUE: index, 0 means this level wrapped and the next one up
+ *                 has to cascade too
+ *   SIDE EFFECTS: call with interrupts off
+ */
+static int32_t cascade(int32_t level, int32_t index){
+    ktimer_t* timer = tvn[level][index];
+    ktimer_t* next;
+    tvn[level][index] = NULL;
+    while (timer != NULL){
+        next = timer->next;
+        internal_add_timer(timer);
+        timer = next;
+    }
+    return index;
+}
+
+/*
+ * init_timer
+ *   DESCRIPTION: set up a timer before its first add_timer
+ *   INPUTS: timer - timer to set up
+ *           fn - callback, runs from SOFTIRQ_TIMER
+ *           data - argument for fn
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void init_timer(ktimer_t* timer, void (*fn)(uint32_t), uint32_t data){
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->data = data;
+}
+
+/*
+ * add_timer
+ *   DESCRIPTION: arm a timer, a pending timer is moved to the new expiry
+ *   INPUTS: timer - timer from init_timer
+ *           expires - tick to run at, in timer_ticks
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void add_timer(ktimer_t* timer, uint32_t expires){
+    uint32_t flags;
+    cli_and_save(flags);
+    del_timer(timer);
+    timer->expires = expires;
+    internal_add_timer(timer);
+    restore_flags(flags);
+}
+
+/*
+ * del_timer
+ *   DESCRIPTION: take a timer off the wheel
+ *   INPUTS: timer - timer from init_timer
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if the timer was pending, 0 if it had run or was
+ *                 never added
+ */
+int32_t del_timer(ktimer_t* timer){
+    uint32_t flags;
+    cli_and_save(flags);
+    if (timer->pprev == NULL){
+        restore_flags(flags);
+        return 0;
+    }
+    *timer->pprev = timer->next;
+    if (timer->next != NULL)
+        timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+    restore_flags(flags);
+    return 1;
+}
+
+/*
+ * timer_pending
+ *   DESCRIPTION: check whether a timer is still waiting to run
+ *   INPUTS: timer - timer from init_timer
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if it is on the wheel, 0 otherwise
+ */
+int32_t timer_pending(ktimer_t* timer){
+    return timer->pprev != NULL;
+}
+
+/*
+ * ms_to_ticks
+ *   DESCRIPTION: convert a delay to ticks, rounded up so a timer never
+ *                runs early
+ *   INPUTS: ms - delay in milliseconds
+ *   OUTPUTS: none
+ *   RETURN VALUE: number of ticks
+ */
+uint32_t ms_to_ticks(uint32_t ms){
+    return ms / MSEC_PER_TICK + (ms % MSEC_PER_TICK != 0);
+}
+
+/*
+ * next_timer_ticks
+ *   DESCRIPTION: how many ticks the wheel can go without running, for idle
+ *                to skip them. A tick that cascades counts as work, timers
+ *                from upper levels may be due right there.
+ *   INPUTS: max - most ticks to look ahead
+ *   OUTPUTS: none
+ *   RETURN VALUE: ticks from now to the first tick with work, max if none
+ *   SIDE EFFECTS: call with interrupts off
+ */
+uint32_t next_timer_ticks(uint32_t max){
+    uint32_t tick, ticks;
+    // ticks the wheel has not run yet
+    if ((int32_t)(timer_ticks - wheel_ticks) >= 0)
+        return 1;
+    for (ticks = 1; ticks < max; ticks++){
+        tick = timer_ticks + ticks;
+        if ((tick & TVR_MASK) == 0 || tv1[tick & TVR_MASK] != NULL)
+            return ticks;
+    }
+    return max;
+}
+
+/*
+ * timer_tick
+ *   DESCRIPTION: advance the clock one tick, the timers that are due now
+ *                run when SOFTIRQ_TIMER calls run_timers
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: called from the PIT interrupt
+ */
+void timer_tick(void){
+    timer_ticks++;
+}
+
+/*
+ * run_timers
+ *   DESCRIPTION: run every timer that is due, for all ticks the wheel is
+ *                behind the clock. Each tick only looks at one tv1 slot, an
+ *                upper level slot is cascaded once every time the level
+ *                below wraps.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: SOFTIRQ_TIMER handler, callbacks run with the caller's
+ *                 interrupt flag, the wheel is only touched with
+ *                 interrupts off
+ */
+void run_timers(void){
+    ktimer_t* work;
+    ktimer_t* timer;
+    int32_t index, level;
+    uint32_t flags;
+    cli_and_save(flags);
+    while ((int32_t)(timer_ticks - wheel_ticks) >= 0){
+        index = wheel_ticks & TVR_MASK;
+        if (index == 0){
+            for (level = 0; level < TVN_LEVELS; level++){
+                if (cascade(level, TVN_INDEX(wheel_ticks, level)) != 0)
+                    break;
+            }
+        }
+        wheel_ticks++;
+        // move the slot to a local list, a callback may delete or re-add
+        // any timer on it
+        work = tv1[index];
+        tv1[index] = NULL;
+        if (work != NULL)
+            work->pprev = &work;
+        while (work != NULL){
+            timer = work;
+            del_timer(timer);
+            restore_flags(flags);
+            timer->fn(timer->data);
+            cli();
+        }
+    }
+    restore_flags(flags);
+}
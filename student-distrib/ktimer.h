@@ -0,0 +1,44 @@
+#ifndef _KTIMER_H
+#define _KTIMER_H
+
+#include "types.h"
+
+/* kernel timers, kept on a hashed timing wheel driven by the 100HZ PIT.
+ * The first level has one slot per tick for the next 256 ticks, each
+ * further level covers 64 times the range of the one below and its slots
+ * are cascaded down when the level below wraps. */
+#define TVR_BITS        8
+#define TVN_BITS        6
+#define TVR_SIZE        (1 << TVR_BITS)
+#define TVN_SIZE        (1 << TVN_BITS)
+#define TVR_MASK        (TVR_SIZE - 1)
+#define TVN_MASK        (TVN_SIZE - 1)
+#define TVN_LEVELS      4
+
+#define HZ              100
+#define MSEC_PER_TICK   (1000 / HZ)
+
+typedef struct ktimer {
+    struct ktimer* next;
+    // link that points at us, NULL while the timer is not pending
+    struct ktimer** pprev;
+    // tick to run at
+    uint32_t expires;
+    // called from SOFTIRQ_TIMER with data, the timer is off the wheel
+    void (*fn)(uint32_t data);
+    uint32_t data;
+} ktimer_t;
+
+/* ticks since boot, the wheel runs every timer up to this one */
+extern volatile uint32_t timer_ticks;
+
+void init_timer(ktimer_t* timer, void (*fn)(uint32_t), uint32_t data);
+void add_timer(ktimer_t* timer, uint32_t expires);
+int32_t del_timer(ktimer_t* timer);
+int32_t timer_pending(ktimer_t* timer);
+uint32_t ms_to_ticks(uint32_t ms);
+uint32_t next_timer_ticks(uint32_t max);
+void timer_tick(void);
+void run_timers(void);
+
+#endif /* _KTIMER_H */
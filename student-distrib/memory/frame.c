@@ -0,0 +1,349 @@
+#include "frame.h"
+#include "../lib.h"
+#include "../vga_design.h"
+
+#define FRAME_RESERVED  0
+#define FRAME_FREE      1
+#define FRAME_USED      2
+
+#define MMAP_AVAILABLE  1
+#define LOWER_MEM_END   0x100000
+#define KERNEL_START    0x400000
+#define KERNEL_END      0x800000
+
+#define CHECK_FLAG(flags, bit)   ((flags) & (1 << (bit)))
+
+/* one descriptor per 4KB frame, only the first frame of a free block is
+ * linked into a free list and carries the block order. The first frame of
+ * an allocated block counts the mappings sharing it. */
+typedef struct frame {
+    struct frame* next;
+    struct frame* prev;
+    uint8_t order;
+    uint8_t flags;
+    uint16_t refcount;
+} frame_t;
+
+static frame_t frame_array[FRAME_MAX_NUM];
+static frame_t* free_area[FRAME_MAX_ORDER + 1];
+
+// number of frames covered by frame_array (end of direct mapped memory)
+static uint32_t frame_num = 0;
+static uint32_t frame_total = 0;
+static uint32_t frame_free = 0;
+
+static int32_t frame_excluded(uint32_t addr, multiboot_info_t* mbi);
+static void free_list_add(frame_t* frame, uint32_t order);
+static void free_list_del(frame_t* frame, uint32_t order);
+static void buddy_free(uint32_t idx, uint32_t order);
+
+/*
+ * free_list_add
+ *   DESCRIPTION: push the head frame of a free block onto its order's list
+ *   INPUTS: frame - head frame of the block
+ *           order - order of the block
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void free_list_add(frame_t* frame, uint32_t order){
+    frame->flags = FRAME_FREE;
+    frame->order = order;
+    frame->prev = NULL;
+    frame->next = free_area[order];
+    if (free_area[order] != NULL)
+        free_area[order]->prev = frame;
+    free_area[order] = frame;
+}
+
+/*
+ * free_list_del
+ *   DESCRIPTION: unlink the head frame of a free block from its order's list
+ *   INPUTS: frame - head frame of the block
+ *           order - order of the block
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void free_list_del(frame_t* frame, uint32_t order){
+    if (frame->prev != NULL)
+        frame->prev->next = frame->next;
+    else
+        free_area[order] = frame->next;
+    if (frame->next != NULL)
+        frame->next->prev = frame->prev;
+    frame->next = NULL;
+    frame->prev = NULL;
+    frame->flags = FRAME_USED;
+}
+
+/*
+ * buddy_free
+ *   DESCRIPTION: put a block back, merging it with its buddy while possible
+ *   INPUTS: idx - index of the first frame of the block
+ *           order - order of the block
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void buddy_free(uint32_t idx, uint32_t order){
+    uint32_t buddy;
+    while (order < FRAME_MAX_ORDER){
+        buddy = idx ^ (1 << order);
+        if (buddy >= frame_num || frame_array[buddy].flags != FRAME_FREE || frame_array[buddy].order != order)
+            break;
+        free_list_del(&frame_array[buddy], order);
+        idx &= buddy;
+        order++;
+    }
+    free_list_add(&frame_array[idx], order);
+}
+
+/*
+ * frame_excluded
+ *   DESCRIPTION: check if a frame is used before the allocator is up
+ *   INPUTS: addr - physical address of the frame
+ *           mbi - multiboot info
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if the frame must never be handed out, 0 otherwise
+ */
+static int32_t frame_excluded(uint32_t addr, multiboot_info_t* mbi){
+    uint32_t i;
+    module_t* mod;
+    // BIOS data, VGA text memory and the terminal buffers
+    if (addr < LOWER_MEM_END)
+        return 1;
+    // kernel image, its page tables and the boot stack
+    if (addr >= KERNEL_START && addr < KERNEL_END)
+        return 1;
+    // the filesystem image stays in place for the whole runtime
+    if (CHECK_FLAG(mbi->flags, 3)){
+        mod = (module_t*)mbi->mods_addr;
+        for (i = 0; i < mbi->mods_count; i++, mod++){
+            if (addr + FRAME_SIZE > mod->mod_start && addr < mod->mod_end)
+                return 1;
+        }
+    }
+    // linear framebuffer of the VBE card
+    if (qemu_vga_addr != 0 && addr >= qemu_vga_addr && addr - qemu_vga_addr < QEMU_VGA_BANK_SIZE)
+        return 1;
+    return 0;
+}
+
+/*
+ * frame_init
+ *   DESCRIPTION: build the buddy free lists from the multiboot memory map
+ *   INPUTS: mbi - multiboot info
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: only memory below FRAME_DIRECT_LIMIT is managed
+ */
+void frame_init(multiboot_info_t* mbi){
+    memory_map_t* mmap;
+    uint32_t i, start, end;
+
+    for (i = 0; i <= FRAME_MAX_ORDER; i++)
+        free_area[i] = NULL;
+    for (i = 0; i < FRAME_MAX_NUM; i++){
+        frame_array[i].next = NULL;
+        frame_array[i].prev = NULL;
+        frame_array[i].order = 0;
+        frame_array[i].flags = FRAME_RESERVED;
+        frame_array[i].refcount = 0;
+    }
+    frame_num = FRAME_MAX_NUM;
+    frame_total = 0;
+    frame_free = 0;
+
+    if (CHECK_FLAG(mbi->flags, 6)){
+        for (mmap = (memory_map_t*)mbi->mmap_addr;
+                (uint32_t)mmap < mbi->mmap_addr + mbi->mmap_length;
+                mmap = (memory_map_t*)((uint32_t)mmap + mmap->size + sizeof(mmap->size))){
+            if (mmap->type != MMAP_AVAILABLE || mmap->base_addr_high != 0 || mmap->base_addr_low >= FRAME_DIRECT_LIMIT)
+                continue;
+            // round inwards to whole frames and clip to the direct map
+            start = (mmap->base_addr_low + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+            if (mmap->length_high != 0 || mmap->length_low >= FRAME_DIRECT_LIMIT - mmap->base_addr_low)
+                end = FRAME_DIRECT_LIMIT;
+            else
+                end = (mmap->base_addr_low + mmap->length_low) & ~(FRAME_SIZE - 1);
+            for (; start < end; start += FRAME_SIZE){
+                i = start >> FRAME_SHIFT;
+                // overlapping regions must not free a frame twice
+                if (frame_array[i].flags != FRAME_RESERVED || frame_excluded(start, mbi))
+                    continue;
+                frame_array[i].flags = FRAME_USED;
+                frame_total++;
+            }
+        }
+    } else if (CHECK_FLAG(mbi->flags, 0)){
+        // no memory map, fall back to the single upper memory region
+        end = LOWER_MEM_END + (mbi->mem_upper << 10);
+        if (mbi->mem_upper >= ((FRAME_DIRECT_LIMIT - LOWER_MEM_END) >> 10))
+            end = FRAME_DIRECT_LIMIT;
+        for (start = LOWER_MEM_END; start + FRAME_SIZE <= end; start += FRAME_SIZE){
+            if (frame_excluded(start, mbi))
+                continue;
+            frame_array[start >> FRAME_SHIFT].flags = FRAME_USED;
+            frame_total++;
+        }
+    }
+
+    // hand every usable frame to the buddy system, blocks merge as they come
+    frame_num = 0;
+    for (i = 0; i < FRAME_MAX_NUM; i++){
+        if (frame_array[i].flags == FRAME_USED)
+            frame_num = i + 1;
+    }
+    for (i = 0; i < frame_num; i++){
+        if (frame_array[i].flags == FRAME_USED){
+            buddy_free(i, FRAME_ORDER_4KB);
+            frame_free++;
+        }
+    }
+}
+
+/*
+ * frame_direct_end
+ *   DESCRIPTION: get the end of the physical memory the kernel maps directly
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: physical address right after the last usable frame
+ */
+uint32_t frame_direct_end(void){
+    return frame_num << FRAME_SHIFT;
+}
+
+/*
+ * alloc_pages
+ *   DESCRIPTION: allocate 2^order contiguous frames, aligned to their size
+ *   INPUTS: order - FRAME_ORDER_4KB up to FRAME_ORDER_4MB
+ *   OUTPUTS: none
+ *   RETURN VALUE: physical address of the block, 0 if memory is exhausted
+ */
+uint32_t alloc_pages(uint32_t order){
+    uint32_t cur_order, idx;
+    frame_t* frame;
+    if (order > FRAME_MAX_ORDER)
+        return 0;
+    for (cur_order = order; cur_order <= FRAME_MAX_ORDER; cur_order++){
+        if (free_area[cur_order] != NULL)
+            break;
+    }
+    if (cur_order > FRAME_MAX_ORDER)
+        return 0;
+    frame = free_area[cur_order];
+    free_list_del(frame, cur_order);
+    idx = frame - frame_array;
+    // split down, giving the upper halves back
+    while (cur_order > order){
+        cur_order--;
+        free_list_add(&frame_array[idx + (1 << cur_order)], cur_order);
+    }
+    frame->order = order;
+    frame->refcount = 1;
+    frame_free -= 1 << order;
+    return idx << FRAME_SHIFT;
+}
+
+/*
+ * free_pages
+ *   DESCRIPTION: give a block from alloc_pages back
+ *   INPUTS: addr - physical address of the block
+ *           order - order it was allocated with
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void free_pages(uint32_t addr, uint32_t order){
+    uint32_t idx = addr >> FRAME_SHIFT;
+    if (addr == 0 || idx >= frame_num || (addr & ((FRAME_SIZE << order) - 1)))
+        return;
+    if (frame_array[idx].flags != FRAME_USED || frame_array[idx].order != order)
+        return;
+    frame_array[idx].refcount = 0;
+    frame_free += 1 << order;
+    buddy_free(idx, order);
+}
+
+/*
+ * frame_get
+ *   DESCRIPTION: take one more reference on an allocated 4KB frame
+ *   INPUTS: addr - physical address of the frame
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void frame_get(uint32_t addr){
+    uint32_t idx = addr >> FRAME_SHIFT;
+    if (idx < frame_num && frame_array[idx].flags == FRAME_USED)
+        frame_array[idx].refcount++;
+}
+
+/*
+ * frame_put
+ *   DESCRIPTION: drop a reference on a 4KB frame, the last one frees it
+ *   INPUTS: addr - physical address of the frame
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void frame_put(uint32_t addr){
+    uint32_t idx = addr >> FRAME_SHIFT;
+    if (idx >= frame_num || frame_array[idx].flags != FRAME_USED || frame_array[idx].refcount == 0)
+        return;
+    if (--frame_array[idx].refcount == 0)
+        free_pages(addr, frame_array[idx].order);
+}
+
+/*
+ * frame_refcount
+ *   DESCRIPTION: number of references on an allocated frame
+ *   INPUTS: addr - physical address of the frame
+ *   OUTPUTS: none
+ *   RETURN VALUE: reference count, 0 if the frame is not allocated
+ */
+uint32_t frame_refcount(uint32_t addr){
+    uint32_t idx = addr >> FRAME_SHIFT;
+    if (idx >= frame_num || frame_array[idx].flags != FRAME_USED)
+        return 0;
+    return frame_array[idx].refcount;
+}
+
+/*
+ * frame_free_count
+ *   DESCRIPTION: number of free 4KB frames
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: free frames
+ */
+uint32_t frame_free_count(void){
+    return frame_free;
+}
+
+/*
+ * frame_used_count
+ *   DESCRIPTION: number of allocated 4KB frames
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: used frames
+ */
+uint32_t frame_used_count(void){
+    return frame_total - frame_free;
+}
+
+/*
+ * alloc_kernel_stack
+ *   DESCRIPTION: allocate an 8KB kernel stack, the pcb lives at its bottom
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: lowest address of the stack, NULL if memory is exhausted
+ */
+void* alloc_kernel_stack(void){
+    return (void*)alloc_pages(FRAME_ORDER_8KB);
+}
+
+/*
+ * free_kernel_stack
+ *   DESCRIPTION: give a kernel stack back
+ *   INPUTS: stack - address returned by alloc_kernel_stack
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void free_kernel_stack(void* stack){
+    free_pages((uint32_t)stack, FRAME_ORDER_8KB);
+}
@@ -0,0 +1,42 @@
+#ifndef _FRAME_H
+#define _FRAME_H
+
+#include "../types.h"
+#include "../multiboot.h"
+
+#define FRAME_SIZE          0x1000
+#define FRAME_SHIFT         12
+#define FRAME_SIZE_4MB      0x400000
+#define FRAME_SHIFT_4MB     22
+
+/* buddy orders, a block of order n is 2^n contiguous 4KB frames */
+#define FRAME_ORDER_4KB     0
+#define FRAME_ORDER_8KB     1
+#define FRAME_ORDER_4MB     10
+#define FRAME_MAX_ORDER     FRAME_ORDER_4MB
+
+/* physical memory below this limit is identity mapped for the kernel,
+ * so every frame we hand out can be touched directly by kernel code */
+#define FRAME_DIRECT_LIMIT  0x08000000
+#define FRAME_MAX_NUM       (FRAME_DIRECT_LIMIT >> FRAME_SHIFT)
+
+#define KSTACK_SIZE         0x2000
+
+void frame_init(multiboot_info_t* mbi);
+uint32_t frame_direct_end(void);
+
+uint32_t alloc_pages(uint32_t order);
+void free_pages(uint32_t addr, uint32_t order);
+
+/* shared frames, e.g. copy-on-write user pages */
+void frame_get(uint32_t addr);
+void frame_put(uint32_t addr);
+uint32_t frame_refcount(uint32_t addr);
+
+uint32_t frame_free_count(void);
+uint32_t frame_used_count(void);
+
+void* alloc_kernel_stack(void);
+void free_kernel_stack(void* stack);
+
+#endif /* _FRAME_H */
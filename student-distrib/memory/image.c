@@ -0,0 +1,122 @@
+#include "image.h"
+#include "frame.h"
+#include "vm.h"
+#include "../lib.h"
+#include "../filesystem/filesys.h"
+
+static image_t images[IMAGE_MAX];
+// slot to give up next when every slot holds an image
+static int32_t next_victim = 0;
+
+static image_t* image_get(uint32_t inode, uint32_t size);
+static void image_drop(image_t* image);
+
+/*
+ * image_map
+ *   DESCRIPTION: map part of a program file into an address space. Every
+ *                instance of a program shares the pages read from the file.
+ *   INPUTS: user_pt - page table of the address space
+ *           inode - inode of the program file
+ *           size - file size in bytes
+ *           offset - file offset of the first byte to map
+ *           vaddr - user address of that byte, same offset in its page
+ *           len - bytes to map, all inside the file
+ *           writable - 1 to copy a page on its first write, 0 for read-only
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 if the file is too large to cache, the
+ *                 range is bad or out of memory, nothing is mapped then
+ */
+int32_t image_map(pte_desc_t* user_pt, uint32_t inode, uint32_t size, uint32_t offset,
+                  uint32_t vaddr, uint32_t len, int32_t writable){
+    uint32_t flags, page, first, last;
+    image_t* image;
+    if (len == 0 || offset > size || len > size - offset
+        || ((offset ^ vaddr) & (FRAME_SIZE - 1)))
+        return FAILURE;
+    first = offset >> FRAME_SHIFT;
+    last = (offset + len - 1) >> FRAME_SHIFT;
+    vaddr &= ~(FRAME_SIZE - 1);
+
+    cli_and_save(flags);
+    image = image_get(inode, size);
+    if (image == NULL){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    for (page = first; page <= last; page++){
+        if (vm_map_image(user_pt, vaddr + ((page - first) << FRAME_SHIFT), image->frames[page], writable) == FAILURE){
+            while (page-- > first)
+                vm_unmap(user_pt, vaddr + ((page - first) << FRAME_SHIFT));
+            restore_flags(flags);
+            return FAILURE;
+        }
+    }
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ * image_get
+ *   DESCRIPTION: find the cached image of a file, or read it into new frames
+ *   INPUTS: inode - inode of the file
+ *           size - file size in bytes
+ *   OUTPUTS: none
+ *   RETURN VALUE: the image, NULL if the file is too large or out of memory
+ *   SIDE EFFECTS: call with interrupts off, may evict another image
+ */
+static image_t* image_get(uint32_t inode, uint32_t size){
+    uint32_t i, len, page_num = (size + FRAME_SIZE - 1) >> FRAME_SHIFT;
+    image_t* image = NULL;
+    int32_t id;
+    if (page_num == 0 || page_num > IMAGE_MAX_PAGES)
+        return NULL;
+    for (id = 0; id < IMAGE_MAX; id++){
+        if (images[id].in_use && images[id].inode == inode && images[id].size == size)
+            return &images[id];
+        if (!images[id].in_use && image == NULL)
+            image = &images[id];
+    }
+    // all slots taken: running instances keep their frames through the
+    // page tables, the cache only drops its own reference
+    if (image == NULL){
+        image = &images[next_victim];
+        next_victim = (next_victim + 1) % IMAGE_MAX;
+        image_drop(image);
+    }
+    for (i = 0; i < page_num; i++){
+        image->frames[i] = alloc_pages(FRAME_ORDER_4KB);
+        if (image->frames[i] == 0){
+            while (i-- > 0)
+                free_pages(image->frames[i], FRAME_ORDER_4KB);
+            return NULL;
+        }
+        len = size - (i << FRAME_SHIFT);
+        if (len > FRAME_SIZE)
+            len = FRAME_SIZE;
+        // keep whatever lies past the end of the file zeroed
+        memset((void*)image->frames[i], 0, FRAME_SIZE);
+        read_data(inode, i << FRAME_SHIFT, (char*)image->frames[i], len);
+    }
+    image->in_use = 1;
+    image->inode = inode;
+    image->size = size;
+    image->page_num = page_num;
+    return image;
+}
+
+/*
+ * image_drop
+ *   DESCRIPTION: remove an image from the cache
+ *   INPUTS: image - cache slot
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: frames still mapped somewhere are freed with their last mapping
+ */
+static void image_drop(image_t* image){
+    uint32_t i;
+    if (!image->in_use)
+        return;
+    for (i = 0; i < image->page_num; i++)
+        frame_put(image->frames[i]);
+    image->in_use = 0;
+}
@@ -0,0 +1,23 @@
+#ifndef _IMAGE_H
+#define _IMAGE_H
+
+#include "../types.h"
+#include "../x86_desc.h"
+
+/* program images kept in memory, larger files are loaded privately */
+#define IMAGE_MAX           16
+#define IMAGE_MAX_PAGES     64
+
+typedef struct image {
+    uint8_t in_use;
+    uint32_t inode;
+    uint32_t size;
+    uint32_t page_num;
+    // the cache holds one reference on every frame
+    uint32_t frames[IMAGE_MAX_PAGES];
+} image_t;
+
+int32_t image_map(pte_desc_t* user_pt, uint32_t inode, uint32_t size, uint32_t offset,
+                  uint32_t vaddr, uint32_t len, int32_t writable);
+
+#endif /* _IMAGE_H */
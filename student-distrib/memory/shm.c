@@ -0,0 +1,203 @@
+#include "shm.h"
+#include "frame.h"
+#include "vm.h"
+#include "../lib.h"
+
+static shm_segment_t shm_segments[SHM_MAX];
+
+static void shm_put(int32_t shm_id);
+static void shm_unmap(process_crtl_block_t* pcb, shm_attach_t* attach);
+
+/*
+ * shm_create
+ *   DESCRIPTION: find the segment with a key, or make it with zeroed frames
+ *   INPUTS: key - name the cooperating processes agree on
+ *           size - bytes, rounded up to whole pages
+ *   OUTPUTS: None
+ *   RETURN VALUE: segment id for success, -1 if out of segments or memory,
+ *                 or an existing segment is smaller than size
+ */
+int32_t shm_create(int32_t key, uint32_t size)
+{
+    uint32_t flags, i, page_num = (size + FRAME_SIZE - 1) >> FRAME_SHIFT;
+    int32_t id, free_id = FAILURE;
+    shm_segment_t* seg;
+    if (page_num == 0 || page_num > SHM_MAX_PAGES)
+        return FAILURE;
+
+    cli_and_save(flags);
+    for (id = 0; id < SHM_MAX; id++){
+        if (!shm_segments[id].in_use){
+            if (free_id == FAILURE)
+                free_id = id;
+            continue;
+        }
+        if (shm_segments[id].key == key){
+            restore_flags(flags);
+            return (shm_segments[id].page_num >= page_num) ? id : FAILURE;
+        }
+    }
+    if (free_id == FAILURE){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    seg = &shm_segments[free_id];
+    for (i = 0; i < page_num; i++){
+        seg->frames[i] = alloc_pages(FRAME_ORDER_4KB);
+        if (seg->frames[i] == 0){
+            while (i-- > 0)
+                free_pages(seg->frames[i], FRAME_ORDER_4KB);
+            restore_flags(flags);
+            return FAILURE;
+        }
+        memset((void*)seg->frames[i], 0, FRAME_SIZE);
+    }
+    seg->in_use = 1;
+    seg->key = key;
+    seg->page_num = page_num;
+    seg->attach_count = 0;
+    restore_flags(flags);
+    return free_id;
+}
+
+/*
+ * shm_attach
+ *   DESCRIPTION: map a segment into the calling process
+ *   INPUTS: shm_id - id from shm_create
+ *           addr - page aligned user address, the range must be unused
+ *   OUTPUTS: None
+ *   RETURN VALUE: 0 for success, -1 for failure
+ */
+int32_t shm_attach(int32_t shm_id, void* addr)
+{
+    uint32_t flags, i, vaddr = (uint32_t)addr;
+    int32_t slot;
+    process_crtl_block_t* pcb = get_cur_pcb();
+    shm_segment_t* seg;
+    if (pcb == NULL || shm_id < 0 || shm_id >= SHM_MAX)
+        return FAILURE;
+    // attachments belong to the address space, i.e. the thread group
+    pcb = pcb->leader;
+
+    cli_and_save(flags);
+    seg = &shm_segments[shm_id];
+    for (slot = 0; slot < SHM_PER_PROCESS && pcb->shm[slot].id != FAILURE; slot++);
+    if (!seg->in_use || slot == SHM_PER_PROCESS ||
+        vaddr > USER_SPACE_END - (seg->page_num << FRAME_SHIFT)){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    for (i = 0; i < seg->page_num; i++){
+        if (vm_map_shared(pcb->user_pt, vaddr + (i << FRAME_SHIFT), seg->frames[i]) == FAILURE){
+            // undo the pages mapped so far
+            while (i-- > 0)
+                vm_unmap(pcb->user_pt, vaddr + (i << FRAME_SHIFT));
+            restore_flags(flags);
+            return FAILURE;
+        }
+    }
+    pcb->shm[slot].id = shm_id;
+    pcb->shm[slot].addr = vaddr;
+    seg->attach_count++;
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ * shm_detach
+ *   DESCRIPTION: unmap a segment from the calling process
+ *   INPUTS: addr - address the segment was attached at
+ *   OUTPUTS: None
+ *   RETURN VALUE: 0 for success, -1 if nothing is attached there
+ */
+int32_t shm_detach(void* addr)
+{
+    uint32_t flags;
+    int32_t slot;
+    process_crtl_block_t* pcb = get_cur_pcb();
+    if (pcb == NULL)
+        return FAILURE;
+    pcb = pcb->leader;
+
+    cli_and_save(flags);
+    for (slot = 0; slot < SHM_PER_PROCESS; slot++){
+        if (pcb->shm[slot].id != FAILURE && pcb->shm[slot].addr == (uint32_t)addr){
+            shm_unmap(pcb, &pcb->shm[slot]);
+            restore_flags(flags);
+            return SUCCESS;
+        }
+    }
+    restore_flags(flags);
+    return FAILURE;
+}
+
+/*
+ * shm_fork
+ *   DESCRIPTION: a fork child inherits the attachments of its parent, the
+ *                pages themselves were shared by vm_share_cow
+ *   INPUTS: child, parent - the two pcbs
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void shm_fork(process_crtl_block_t* child, process_crtl_block_t* parent)
+{
+    int32_t slot;
+    for (slot = 0; slot < SHM_PER_PROCESS; slot++){
+        child->shm[slot] = parent->leader->shm[slot];
+        if (child->shm[slot].id != FAILURE)
+            shm_segments[child->shm[slot].id].attach_count++;
+    }
+}
+
+/*
+ * shm_exit
+ *   DESCRIPTION: detach everything from an exiting process
+ *   INPUTS: pcb - leader of the process
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void shm_exit(process_crtl_block_t* pcb)
+{
+    int32_t slot;
+    for (slot = 0; slot < SHM_PER_PROCESS; slot++){
+        if (pcb->shm[slot].id != FAILURE)
+            shm_unmap(pcb, &pcb->shm[slot]);
+    }
+}
+
+/*
+ * shm_unmap
+ *   DESCRIPTION: remove one attachment and drop its segment reference
+ *   INPUTS: pcb - leader of the process
+ *           attach - the attachment
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void shm_unmap(process_crtl_block_t* pcb, shm_attach_t* attach)
+{
+    uint32_t i;
+    shm_segment_t* seg = &shm_segments[attach->id];
+    for (i = 0; i < seg->page_num; i++)
+        vm_unmap(pcb->user_pt, attach->addr + (i << FRAME_SHIFT));
+    shm_put(attach->id);
+    attach->id = FAILURE;
+}
+
+/*
+ * shm_put
+ *   DESCRIPTION: drop an attachment, the last one frees the segment
+ *   INPUTS: shm_id - the segment
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void shm_put(int32_t shm_id)
+{
+    uint32_t i;
+    shm_segment_t* seg = &shm_segments[shm_id];
+    if (--seg->attach_count > 0)
+        return;
+    // frames still mapped somewhere go away with their last mapping
+    for (i = 0; i < seg->page_num; i++)
+        frame_put(seg->frames[i]);
+    seg->in_use = 0;
+}
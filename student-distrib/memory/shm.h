@@ -0,0 +1,26 @@
+#ifndef _SHM_H
+#define _SHM_H
+
+#include "../types.h"
+#include "../process_crtl.h"
+
+#define SHM_MAX             16
+#define SHM_MAX_PAGES       64
+
+typedef struct shm_segment {
+    uint8_t in_use;
+    int32_t key;
+    uint32_t page_num;
+    // attachments across every process, the last detach frees the frames
+    int32_t attach_count;
+    uint32_t frames[SHM_MAX_PAGES];
+} shm_segment_t;
+
+int32_t shm_create(int32_t key, uint32_t size);
+int32_t shm_attach(int32_t shm_id, void* addr);
+int32_t shm_detach(void* addr);
+
+void shm_fork(process_crtl_block_t* child, process_crtl_block_t* parent);
+void shm_exit(process_crtl_block_t* pcb);
+
+#endif /* _SHM_H */
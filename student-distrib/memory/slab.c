@@ -0,0 +1,271 @@
+#include "slab.h"
+#include "frame.h"
+#include "../lib.h"
+
+// every cache, for kmem_reap and kmem_stats
+static kmem_cache_t* cache_list = NULL;
+static kmem_cache_t kmalloc_caches[KMALLOC_CLASSES];
+static const int8_t* kmalloc_names[KMALLOC_CLASSES] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128", "kmalloc-256", "kmalloc-512"
+};
+
+static slab_t* slab_create(kmem_cache_t* cache);
+static void slab_unlink(slab_t** list, slab_t* slab);
+
+#define SLAB_BYTES(cache)       (FRAME_SIZE << (cache)->order)
+#define SLAB_OBJ(cache, slab, i) ((uint8_t*)(slab) + (cache)->obj_offset + (i) * (cache)->obj_size)
+
+/*
+ * kmem_init
+ *   DESCRIPTION: set up the kmalloc size classes
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: call after frame_init
+ */
+void kmem_init(void){
+    int32_t i;
+    for (i = 0; i < KMALLOC_CLASSES; i++)
+        kmem_cache_init(&kmalloc_caches[i], kmalloc_names[i], 1 << (i + KMALLOC_MIN_SHIFT), NULL);
+}
+
+/*
+ * kmem_cache_init
+ *   DESCRIPTION: make a cache of equally sized objects. Slabs are the
+ *                smallest buddy block that holds a few objects.
+ *   INPUTS: cache - storage for the cache, lives as long as the kernel
+ *           name - shown by kmem_stats
+ *           size - object size in bytes
+ *           ctor - object constructor, may be NULL
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 if an object does not fit in a slab
+ */
+int32_t kmem_cache_init(kmem_cache_t* cache, const int8_t* name, uint32_t size, void (*ctor)(void* obj)){
+    uint32_t order, n, offset;
+    size = (size + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+    if (size == 0)
+        return FAILURE;
+    for (order = 0; order <= SLAB_MAX_ORDER; order++){
+        // room for the header, one free index and the object each
+        n = ((FRAME_SIZE << order) - sizeof(slab_t)) / (size + sizeof(uint16_t));
+        offset = (sizeof(slab_t) + n * sizeof(uint16_t) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+        while (n > 0 && offset + n * size > (FRAME_SIZE << order)){
+            n--;
+            offset = (sizeof(slab_t) + n * sizeof(uint16_t) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+        }
+        if (n >= SLAB_MIN_OBJS || (order == SLAB_MAX_ORDER && n > 0))
+            break;
+    }
+    if (order > SLAB_MAX_ORDER)
+        return FAILURE;
+    memset(cache, 0, sizeof(kmem_cache_t));
+    cache->name = name;
+    cache->obj_size = size;
+    cache->order = order;
+    cache->obj_per_slab = n;
+    cache->obj_offset = offset;
+    cache->ctor = ctor;
+    cache->next = cache_list;
+    cache_list = cache;
+    return SUCCESS;
+}
+
+/*
+ * kmem_cache_alloc
+ *   DESCRIPTION: take an object from a cache, partly used slabs first
+ *   INPUTS: cache - the cache
+ *   OUTPUTS: none
+ *   RETURN VALUE: the object, NULL if out of memory
+ */
+void* kmem_cache_alloc(kmem_cache_t* cache){
+    uint32_t flags;
+    slab_t* slab;
+    void* obj;
+
+    cli_and_save(flags);
+    slab = cache->partial;
+    if (slab == NULL){
+        slab = cache->empty;
+        if (slab != NULL)
+            slab_unlink(&cache->empty, slab);
+        else if ((slab = slab_create(cache)) == NULL){
+            restore_flags(flags);
+            return NULL;
+        }
+        slab->next = cache->partial;
+        cache->partial = slab;
+    }
+    obj = SLAB_OBJ(cache, slab, slab->free_head);
+    slab->free_head = slab->free_next[slab->free_head];
+    slab->in_use++;
+    if (slab->in_use == cache->obj_per_slab){
+        slab_unlink(&cache->partial, slab);
+        slab->next = cache->full;
+        cache->full = slab;
+    }
+    cache->obj_in_use++;
+    cache->alloc_count++;
+    restore_flags(flags);
+    return obj;
+}
+
+/*
+ * kmem_cache_free
+ *   DESCRIPTION: give an object back to its cache
+ *   INPUTS: cache - the cache it came from
+ *           obj - the object, in its constructed state
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: keeps one empty slab for reuse, frees any other
+ */
+void kmem_cache_free(kmem_cache_t* cache, void* obj){
+    uint32_t flags, idx;
+    slab_t* slab;
+    if (obj == NULL)
+        return;
+    // buddy blocks are aligned to their size
+    slab = (slab_t*)((uint32_t)obj & ~(SLAB_BYTES(cache) - 1));
+    idx = ((uint8_t*)obj - SLAB_OBJ(cache, slab, 0)) / cache->obj_size;
+
+    cli_and_save(flags);
+    if (slab->in_use == cache->obj_per_slab){
+        slab_unlink(&cache->full, slab);
+        slab->next = cache->partial;
+        cache->partial = slab;
+    }
+    slab->free_next[idx] = slab->free_head;
+    slab->free_head = idx;
+    slab->in_use--;
+    if (slab->in_use == 0){
+        slab_unlink(&cache->partial, slab);
+        if (cache->empty == NULL){
+            slab->next = NULL;
+            cache->empty = slab;
+        } else {
+            free_pages((uint32_t)slab, cache->order);
+            cache->slab_count--;
+        }
+    }
+    cache->obj_in_use--;
+    cache->free_count++;
+    restore_flags(flags);
+}
+
+/*
+ * kmem_cache_shrink
+ *   DESCRIPTION: give the empty slab of a cache back to the page allocator
+ *   INPUTS: cache - the cache
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void kmem_cache_shrink(kmem_cache_t* cache){
+    uint32_t flags;
+    slab_t* slab;
+    cli_and_save(flags);
+    while ((slab = cache->empty) != NULL){
+        cache->empty = slab->next;
+        free_pages((uint32_t)slab, cache->order);
+        cache->slab_count--;
+    }
+    restore_flags(flags);
+}
+
+/*
+ * kmem_reap
+ *   DESCRIPTION: shrink every cache
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void kmem_reap(void){
+    kmem_cache_t* cache;
+    for (cache = cache_list; cache != NULL; cache = cache->next)
+        kmem_cache_shrink(cache);
+}
+
+/*
+ * kmem_stats
+ *   DESCRIPTION: print the usage of every cache
+ *   INPUTS: none
+ *   OUTPUTS: one line per cache on the screen
+ *   RETURN VALUE: none
+ */
+void kmem_stats(void){
+    kmem_cache_t* cache;
+    printf("cache          size  slabs  in use  allocs  frees\n");
+    for (cache = cache_list; cache != NULL; cache = cache->next)
+        printf("%s  %u  %u  %u  %u  %u\n", cache->name, cache->obj_size, cache->slab_count,
+               cache->obj_in_use, cache->alloc_count, cache->free_count);
+}
+
+/*
+ * kmalloc
+ *   DESCRIPTION: allocate from the smallest size class that fits
+ *   INPUTS: size - bytes, at most KMALLOC_MAX, larger objects need their
+ *                  own cache or alloc_pages
+ *   OUTPUTS: none
+ *   RETURN VALUE: the memory, NULL if out of memory or too large
+ */
+void* kmalloc(uint32_t size){
+    int32_t i;
+    for (i = 0; i < KMALLOC_CLASSES; i++){
+        if (size <= kmalloc_caches[i].obj_size)
+            return kmem_cache_alloc(&kmalloc_caches[i]);
+    }
+    return NULL;
+}
+
+/*
+ * kfree
+ *   DESCRIPTION: free memory from kmalloc
+ *   INPUTS: obj - the memory, may be NULL
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void kfree(void* obj){
+    // kmalloc slabs are single frames, the header names the cache
+    if (obj != NULL)
+        kmem_cache_free(((slab_t*)((uint32_t)obj & ~(FRAME_SIZE - 1)))->cache, obj);
+}
+
+/*
+ * slab_create
+ *   DESCRIPTION: get a new slab for a cache and construct its objects
+ *   INPUTS: cache - the cache
+ *   OUTPUTS: none
+ *   RETURN VALUE: the slab, not on any list yet, NULL if out of memory
+ */
+static slab_t* slab_create(kmem_cache_t* cache){
+    uint32_t i;
+    slab_t* slab = (slab_t*)alloc_pages(cache->order);
+    if (slab == NULL)
+        return NULL;
+    slab->cache = cache;
+    slab->next = NULL;
+    slab->in_use = 0;
+    slab->free_head = 0;
+    for (i = 0; i < cache->obj_per_slab; i++){
+        slab->free_next[i] = i + 1;
+        if (cache->ctor != NULL)
+            cache->ctor(SLAB_OBJ(cache, slab, i));
+    }
+    cache->slab_count++;
+    return slab;
+}
+
+/*
+ * slab_unlink
+ *   DESCRIPTION: take a slab off one of the lists of its cache
+ *   INPUTS: list - head of the list
+ *           slab - slab on that list
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void slab_unlink(slab_t** list, slab_t* slab){
+    for (; *list != NULL; list = &(*list)->next){
+        if (*list == slab){
+            *list = slab->next;
+            return;
+        }
+    }
+}
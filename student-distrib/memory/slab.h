@@ -0,0 +1,61 @@
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include "../types.h"
+#include "../process_crtl.h"
+
+/* a slab is one buddy block, grown until it holds SLAB_MIN_OBJS objects */
+#define SLAB_MAX_ORDER      2
+#define SLAB_MIN_OBJS       4
+#define SLAB_ALIGN          8
+
+/* kmalloc size classes: 16, 32, ... 512 bytes, all in 4KB slabs */
+#define KMALLOC_MIN_SHIFT   4
+#define KMALLOC_CLASSES     6
+#define KMALLOC_MAX         (1 << (KMALLOC_MIN_SHIFT + KMALLOC_CLASSES - 1))
+
+struct kmem_cache;
+
+/* head of a slab, followed by the free index list and the objects */
+typedef struct slab {
+    struct kmem_cache* cache;
+    struct slab* next;
+    uint32_t in_use;
+    // index of the first free object, obj_per_slab if none
+    uint16_t free_head;
+    uint16_t free_next[0];
+} slab_t;
+
+typedef struct kmem_cache {
+    const int8_t* name;
+    uint32_t obj_size;
+    uint32_t order;
+    uint32_t obj_per_slab;
+    uint32_t obj_offset;
+    // runs once per object when its slab is made, freed objects must be
+    // handed back in the constructed state
+    void (*ctor)(void* obj);
+    slab_t* partial;
+    slab_t* full;
+    slab_t* empty;
+    // stats
+    uint32_t slab_count;
+    uint32_t obj_in_use;
+    uint32_t alloc_count;
+    uint32_t free_count;
+    struct kmem_cache* next;
+} kmem_cache_t;
+
+void kmem_init(void);
+
+int32_t kmem_cache_init(kmem_cache_t* cache, const int8_t* name, uint32_t size, void (*ctor)(void* obj));
+void* kmem_cache_alloc(kmem_cache_t* cache);
+void kmem_cache_free(kmem_cache_t* cache, void* obj);
+void kmem_cache_shrink(kmem_cache_t* cache);
+void kmem_reap(void);
+void kmem_stats(void);
+
+void* kmalloc(uint32_t size);
+void kfree(void* obj);
+
+#endif /* _SLAB_H */
@@ -0,0 +1,346 @@
+#include "vm.h"
+#include "frame.h"
+#include "../lib.h"
+#include "../page.h"
+
+#define USER_PTE_IDX(vaddr)     (((vaddr) - USER_SPACE_BEGIN) >> FRAME_SHIFT)
+
+static int32_t vm_break_cow(pte_desc_t* pte);
+
+/*
+ * vm_create
+ *   DESCRIPTION: allocate an empty page table for the user space
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the page table, NULL if out of memory
+ */
+pte_desc_t* vm_create(void){
+    pte_desc_t* user_pt = (pte_desc_t*)alloc_pages(FRAME_ORDER_4KB);
+    if (user_pt != NULL)
+        memset(user_pt, 0, FRAME_SIZE);
+    return user_pt;
+}
+
+/*
+ * vm_destroy
+ *   DESCRIPTION: drop every user page and the page table itself
+ *   INPUTS: user_pt - page table from vm_create
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: shared pages are only freed with their last mapping
+ */
+void vm_destroy(pte_desc_t* user_pt){
+    int32_t i;
+    if (user_pt == NULL)
+        return;
+    for (i = 0; i < PAGE_ENTRY_NUM; i++){
+        if (user_pt[i].present)
+            frame_put(user_pt[i].base_addr << FRAME_SHIFT);
+    }
+    free_pages((uint32_t)user_pt, FRAME_ORDER_4KB);
+}
+
+/*
+ * vm_map_zero
+ *   DESCRIPTION: back a user range with zeroed, writable pages
+ *   INPUTS: user_pt - page table of the address space
+ *           vaddr - start of the range
+ *           len - length of the range in bytes
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 if out of memory or outside user space
+ *   SIDE EFFECTS: pages already present are left alone
+ */
+int32_t vm_map_zero(pte_desc_t* user_pt, uint32_t vaddr, uint32_t len){
+    uint32_t addr, frame;
+    pte_desc_t* pte;
+    if (vaddr < USER_SPACE_BEGIN || vaddr >= USER_SPACE_END || len > USER_SPACE_END - vaddr)
+        return FAILURE;
+    for (addr = vaddr & ~(FRAME_SIZE - 1); addr < vaddr + len; addr += FRAME_SIZE){
+        pte = &user_pt[USER_PTE_IDX(addr)];
+        if (pte->present)
+            continue;
+        frame = alloc_pages(FRAME_ORDER_4KB);
+        if (frame == 0)
+            return FAILURE;
+        memset((void*)frame, 0, FRAME_SIZE);
+        pte->val = 0;
+        pte->read_write = 1;
+        pte->usr_or_supervisor = 1;
+        pte->base_addr = frame >> FRAME_SHIFT;
+        pte->present = 1;
+    }
+    return SUCCESS;
+}
+
+/*
+ * vm_share_cow
+ *   DESCRIPTION: map every user page of src into dst as well. Writable pages
+ *                become read-only copy-on-write in both tables, except for
+ *                shared memory pages.
+ *   INPUTS: dst - empty page table of the new address space
+ *           src - page table to share
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: the caller must flush the TLB if src is the live table
+ */
+void vm_share_cow(pte_desc_t* dst, pte_desc_t* src){
+    int32_t i;
+    for (i = 0; i < PAGE_ENTRY_NUM; i++){
+        if (!src[i].present)
+            continue;
+        // shared memory stays shared, everything else is copied on write
+        if (src[i].read_write && !(src[i].avail & PTE_SHARED)){
+            src[i].read_write = 0;
+            src[i].avail |= PTE_COW;
+        }
+        dst[i] = src[i];
+        frame_get(src[i].base_addr << FRAME_SHIFT);
+    }
+}
+
+/*
+ * vm_map_shared
+ *   DESCRIPTION: map a frame of a shared memory segment at a user address
+ *   INPUTS: user_pt - page table of the address space
+ *           vaddr - page aligned user address, must be unused
+ *           frame - physical frame, takes a reference on it
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 if the address is taken or outside user space
+ */
+int32_t vm_map_shared(pte_desc_t* user_pt, uint32_t vaddr, uint32_t frame){
+    pte_desc_t* pte;
+    if (vaddr < USER_SPACE_BEGIN || vaddr >= USER_SPACE_END || (vaddr & (FRAME_SIZE - 1)))
+        return FAILURE;
+    pte = &user_pt[USER_PTE_IDX(vaddr)];
+    if (pte->present)
+        return FAILURE;
+    frame_get(frame);
+    pte->val = 0;
+    pte->read_write = 1;
+    pte->usr_or_supervisor = 1;
+    pte->avail = PTE_SHARED;
+    pte->base_addr = frame >> FRAME_SHIFT;
+    pte->present = 1;
+    return SUCCESS;
+}
+
+/*
+ * vm_map_image
+ *   DESCRIPTION: map a frame of a program image read-only at a user address.
+ *                In a writable mapping the first write gives the address
+ *                space its own copy, otherwise writes fault.
+ *   INPUTS: user_pt - page table of the address space
+ *           vaddr - page aligned user address, must be unused
+ *           frame - physical frame, takes a reference on it
+ *           writable - 1 for copy-on-write, 0 for read-only
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 if the address is taken or outside user space
+ */
+int32_t vm_map_image(pte_desc_t* user_pt, uint32_t vaddr, uint32_t frame, int32_t writable){
+    pte_desc_t* pte;
+    if (vaddr < USER_SPACE_BEGIN || vaddr >= USER_SPACE_END || (vaddr & (FRAME_SIZE - 1)))
+        return FAILURE;
+    pte = &user_pt[USER_PTE_IDX(vaddr)];
+    if (pte->present)
+        return FAILURE;
+    frame_get(frame);
+    pte->val = 0;
+    pte->usr_or_supervisor = 1;
+    pte->avail = writable ? PTE_COW : 0;
+    pte->base_addr = frame >> FRAME_SHIFT;
+    pte->present = 1;
+    return SUCCESS;
+}
+
+/*
+ * vm_unmap
+ *   DESCRIPTION: remove a user page and drop its frame reference
+ *   INPUTS: user_pt - page table of the address space
+ *           vaddr - user address in the page
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: only flushes the TLB entry of the live address space
+ */
+void vm_unmap(pte_desc_t* user_pt, uint32_t vaddr){
+    pte_desc_t* pte;
+    if (vaddr < USER_SPACE_BEGIN || vaddr >= USER_SPACE_END)
+        return;
+    pte = &user_pt[USER_PTE_IDX(vaddr)];
+    if (!pte->present)
+        return;
+    frame_put(pte->base_addr << FRAME_SHIFT);
+    pte->val = 0;
+    invlpg(vaddr);
+}
+
+/*
+ * vm_break_cow
+ *   DESCRIPTION: give the faulting address space its own copy of a page
+ *   INPUTS: pte - copy-on-write entry in the live page table
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 if out of memory
+ */
+static int32_t vm_break_cow(pte_desc_t* pte){
+    uint32_t old_frame = pte->base_addr << FRAME_SHIFT;
+    uint32_t new_frame;
+    // still shared: copy it, otherwise we are the last user and keep it
+    if (frame_refcount(old_frame) > 1){
+        new_frame = alloc_pages(FRAME_ORDER_4KB);
+        if (new_frame == 0)
+            return FAILURE;
+        memcpy((void*)new_frame, (void*)old_frame, FRAME_SIZE);
+        pte->base_addr = new_frame >> FRAME_SHIFT;
+        frame_put(old_frame);
+    }
+    pte->avail &= ~PTE_COW;
+    pte->read_write = 1;
+    return SUCCESS;
+}
+
+/*
+ * vm_lazy_area
+ *   DESCRIPTION: tell whether a missing user page may be filled with zeros:
+ *                the program, its bss and heap up to the break, and the
+ *                stack above its guard page
+ *   INPUTS: pcb - any thread of the address space
+ *           vaddr - user virtual address
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if it may, 0 if touching it is a fault
+ */
+int32_t vm_lazy_area(process_crtl_block_t* pcb, uint32_t vaddr){
+    uint32_t brk = pcb->leader->brk;
+    return (vaddr >= USER_SPACE_BEGIN && vaddr < brk)
+        || (vaddr >= USER_STACK_LIMIT && vaddr < USER_SPACE_END);
+}
+
+/*
+ * vm_user_phys
+ *   DESCRIPTION: find the frame behind a user address, with the page made
+ *                present and private as if it had just been written
+ *   INPUTS: pcb - current process, its page table is the live one
+ *           vaddr - user virtual address
+ *   OUTPUTS: none
+ *   RETURN VALUE: physical address of vaddr, 0 if it is not a valid user
+ *                 address or out of memory
+ *   SIDE EFFECTS: call with interrupts off
+ */
+uint32_t vm_user_phys(process_crtl_block_t* pcb, uint32_t vaddr){
+    pte_desc_t* pte;
+    if (vaddr < USER_SPACE_BEGIN || vaddr >= USER_SPACE_END)
+        return 0;
+    pte = &pcb->user_pt[USER_PTE_IDX(vaddr)];
+    if (!pte->present){
+        if (!vm_lazy_area(pcb, vaddr)
+            || vm_map_zero(pcb->user_pt, vaddr & ~(FRAME_SIZE - 1), FRAME_SIZE) == FAILURE)
+            return 0;
+    } else if (pte->avail & PTE_COW){
+        if (vm_break_cow(pte) == FAILURE)
+            return 0;
+        invlpg(vaddr);
+    }
+    return (pte->base_addr << FRAME_SHIFT) | (vaddr & (FRAME_SIZE - 1));
+}
+
+/*
+ * vm_user_writable
+ *   DESCRIPTION: make sure the kernel may store to a user buffer: every page
+ *                of it is made present and private, and has to be writable.
+ *                The kernel writes with CR0.WP on, a store to a read-only
+ *                page, e.g. the time page or program text, would fault.
+ *   INPUTS: pcb - current process, its page table is the live one
+ *           vaddr - start of the buffer
+ *           len - size of the buffer in bytes
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 if the buffer may be written, -1 if it leaves the user
+ *                 space, is read-only, or out of memory
+ *   SIDE EFFECTS: may fill pages with zeros or copy shared ones
+ */
+int32_t vm_user_writable(process_crtl_block_t* pcb, uint32_t vaddr, uint32_t len){
+    uint32_t addr, flags;
+    int32_t ret = SUCCESS;
+    if (pcb == NULL || pcb->user_pt == NULL || vaddr < USER_SPACE_BEGIN
+        || vaddr >= USER_SPACE_END || len > USER_SPACE_END - vaddr)
+        return FAILURE;
+
+    cli_and_save(flags);
+    for (addr = vaddr & ~(FRAME_SIZE - 1); addr < vaddr + len; addr += FRAME_SIZE){
+        if (vm_user_phys(pcb, addr) == 0 || !pcb->user_pt[USER_PTE_IDX(addr)].read_write){
+            ret = FAILURE;
+            break;
+        }
+    }
+    restore_flags(flags);
+    return ret;
+}
+
+/*
+ * sbrk
+ *   DESCRIPTION: move the end of the heap. Growing only moves the break,
+ *                pages are filled with zeros on first touch. Shrinking
+ *                drops the pages above the new break.
+ *   INPUTS: increment - bytes to add, negative to give memory back
+ *   OUTPUTS: none
+ *   RETURN VALUE: the old break for success, -1 if the heap would leave
+ *                 [heap start, stack guard page)
+ */
+int32_t sbrk(int32_t increment){
+    process_crtl_block_t* pcb = get_cur_pcb();
+    uint32_t flags, old_brk, new_brk, addr;
+    if (pcb == NULL)
+        return FAILURE;
+    // the heap belongs to the address space, i.e. the thread group
+    pcb = pcb->leader;
+
+    cli_and_save(flags);
+    old_brk = pcb->brk;
+    new_brk = old_brk + increment;
+    if (pcb->heap_start == 0
+        || (increment > 0 && (new_brk < old_brk || new_brk > USER_STACK_LIMIT - FRAME_SIZE))
+        || (increment < 0 && (new_brk > old_brk || new_brk < pcb->heap_start))){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    addr = (new_brk + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+    for (; addr < old_brk; addr += FRAME_SIZE){
+        // shared memory attached in the range stays until shm_detach
+        if (!(pcb->user_pt[USER_PTE_IDX(addr)].avail & PTE_SHARED))
+            vm_unmap(pcb->user_pt, addr);
+    }
+    pcb->brk = new_brk;
+    restore_flags(flags);
+    return (int32_t)old_brk;
+}
+
+/*
+ * page_fault_handler
+ *   DESCRIPTION: resolve faults on user pages: untouched pages of the
+ *                program, heap and stack are filled with zeros and writes to
+ *                shared pages get a private copy
+ *   INPUTS: r - the H/W content pushed by the exception stub
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 if the access can be retried, -1 for a real fault
+ */
+asmlinkage int32_t page_fault_handler(sig_regs r){
+    process_crtl_block_t* pcb = get_cur_pcb();
+    pte_desc_t* pte;
+    uint32_t addr, flags;
+    int32_t ret = FAILURE;
+
+    asm volatile ("movl %%cr2, %0" : "=r"(addr));
+    if (pcb == NULL || pcb->user_pt == NULL || addr < USER_SPACE_BEGIN || addr >= USER_SPACE_END)
+        return FAILURE;
+
+    // frames and page tables are shared with other processes
+    cli_and_save(flags);
+    pte = &pcb->user_pt[USER_PTE_IDX(addr)];
+    if (!pte->present){
+        // outside the program, heap and stack, e.g. the stack guard page
+        if (vm_lazy_area(pcb, addr))
+            ret = vm_map_zero(pcb->user_pt, addr & ~(FRAME_SIZE - 1), FRAME_SIZE);
+    }
+    else if ((r.err & PF_WRITE) && (pte->avail & PTE_COW))
+        ret = vm_break_cow(pte);
+    invlpg(addr);
+    restore_flags(flags);
+    return ret;
+}
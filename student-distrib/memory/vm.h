@@ -0,0 +1,47 @@
+#ifndef _VM_H
+#define _VM_H
+
+#include "../types.h"
+#include "../x86_desc.h"
+#include "../process_crtl.h"
+#include "frame.h"
+
+/* the user part of every address space, backed by 4KB pages */
+#define USER_SPACE_BEGIN    0x08000000
+#define USER_SPACE_END      0x08400000
+
+/* the stack grows down on demand to USER_STACK_LIMIT, the page below it is
+ * a guard page, and the heap may not grow into it */
+#define USER_STACK_MAX      0x100000
+#define USER_STACK_LIMIT    (USER_SPACE_END - USER_STACK_MAX + FRAME_SIZE)
+
+/* PTE avail bits: the page is shared and gets copied on the first write,
+ * or it belongs to a shared memory segment and stays shared on fork */
+#define PTE_COW             0x1
+#define PTE_SHARED          0x2
+
+#ifndef asmlinkage
+#define asmlinkage __attribute__((regparm(0)))
+#endif
+
+/* page fault error code */
+#define PF_PRESENT          0x1
+#define PF_WRITE            0x2
+#define PF_USER             0x4
+
+pte_desc_t* vm_create(void);
+void vm_destroy(pte_desc_t* user_pt);
+
+int32_t vm_map_zero(pte_desc_t* user_pt, uint32_t vaddr, uint32_t len);
+void vm_share_cow(pte_desc_t* dst, pte_desc_t* src);
+uint32_t vm_user_phys(process_crtl_block_t* pcb, uint32_t vaddr);
+int32_t vm_user_writable(process_crtl_block_t* pcb, uint32_t vaddr, uint32_t len);
+int32_t vm_lazy_area(process_crtl_block_t* pcb, uint32_t vaddr);
+int32_t sbrk(int32_t increment);
+int32_t vm_map_shared(pte_desc_t* user_pt, uint32_t vaddr, uint32_t frame);
+int32_t vm_map_image(pte_desc_t* user_pt, uint32_t vaddr, uint32_t frame, int32_t writable);
+void vm_unmap(pte_desc_t* user_pt, uint32_t vaddr);
+
+asmlinkage int32_t page_fault_handler(sig_regs r);
+
+#endif /* _VM_H */
@@ -4,6 +4,7 @@
 #include "terminal.h"
 #include "do_syscall.h"
 #include "vga_design.h"
+#include "memory/frame.h"
 // #define KERNEL_PD_IDX       KERNEL_PAGE_BEGIN>>22
 // #define VID_PD_IDX          VIDEO_MEM_BEGIN>>22
 // #define VID_PT_IDX_BEGIN    (VIDEO_MEM_BEGIN & PTE_BASE_MASK)>>12
@@ -13,6 +14,7 @@
 #define VID_PD_IDX          0
 #define VID_PT_IDX_BEGIN    0xB8
 #define VID_PT_IDX_END      0xB9
+#define LOWER_MEM_PT_IDX    0x100
 
 static void enable_paging();
 
@@ -71,11 +73,30 @@ void init_paging(){
     // check_point3 = KERNEL_PD_IDX;
     page_directory[VID_PD_IDX].KB.base_addr = (uint32_t)page_table>>12;
     page_directory[KERNEL_PD_IDX].MB.base_addr = KERNEL_PD_IDX;
+    // direct map the frames handed out by the frame allocator, kernel only
+    for (i=LOWER_MEM_PT_IDX; i<PAGE_ENTRY_NUM; i++){
+        page_table[i].present = 1;
+        page_table[i].read_write = 1;
+        page_table[i].usr_or_supervisor = 0;
+        page_table[i].global = 1;
+        page_table[i].base_addr = i;
+    }
+    for (i=KERNEL_PD_IDX+1; i<((frame_direct_end()+FRAME_SIZE_4MB-1)>>OFFSET_22); i++){
+        if (page_directory[i].MB.present)
+            continue;
+        page_directory[i].MB.present = 1;
+        page_directory[i].MB.page_size = 1;
+        page_directory[i].MB.base_addr = i;
+        page_directory[i].MB.read_write = 1;
+        page_directory[i].MB.global = 1;
+        page_directory[i].MB.usr_or_supervisor = 0;
+    }
     // set page tables 
     for (i=VID_PT_IDX_BEGIN; i<VID_PT_IDX_END+BG_BUF_NUM; i++){
         page_table[i].present = 1;
         page_table[i].read_write = 1;
         page_table[i].usr_or_supervisor = 0;
+        page_table[i].global = 1;
         page_table[i].base_addr = i;
     }
 
@@ -88,7 +109,9 @@ void init_paging(){
  *   INPUTS: none 
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: tell the CPU about the paging stuff
+ *   SIDE EFFECTS: tell the CPU about the paging stuff, 4MB pages (PSE) and
+ *                 global pages (PGE) are turned on, and kernel writes honour
+ *                 read-only user pages (WP) so copy-on-write works for them
  * 
  * ref: https://wiki.osdev.org/Paging
  */
@@ -98,51 +121,79 @@ static void enable_paging(){
         "movl %%eax, %%cr3 \n\t"
         "xorl %%eax, %%eax \n\t"
         "movl %%cr4, %%eax \n\t"
-        "orl $0x00000010, %%eax \n\t"
+        "orl $0x00000090, %%eax \n\t"
         "movl %%eax, %%cr4 \n\t"
         "xorl %%eax, %%eax \n\t"
         "movl %%cr0, %%eax \n\t"
-        "orl $0x80000000, %%eax \n\t"
+        "orl $0x80010000, %%eax \n\t"
         "movl %%eax, %%cr0 \n\t"
 
         : :"r"(page_directory) : "memory", "%eax"
     );
 }
 
-/* set_user_pt
- *   DESCRIPTION: set up page table (4MB) for user program          
+/*
+ * alloc_page_dir
+ *   DESCRIPTION: create the page directory of a new process. The kernel half
+ *                is shared with every other process and mapped global, only
+ *                the user image is private.
+ *   INPUTS: user_pt - page table of the user space
+ *   OUTPUTS: none
+ *   RETURN VALUE: the new page directory, NULL if out of memory
+ */
+pde_desc_t* alloc_page_dir(pte_desc_t* user_pt){
+    static uint32_t user_idx = USER_MEMORY >> OFFSET_4MB;
+    pde_desc_t* pd = (pde_desc_t*)alloc_pages(FRAME_ORDER_4KB);
+    int i;
+    if (pd == NULL)
+        return NULL;
+    // kernel mappings never change after init_paging, copying them is enough
+    for (i=0; i<PAGE_ENTRY_NUM; i++)
+        pd[i].val = page_directory[i].val;
+
+    // user pages are 4KB so they can be shared copy-on-write
+    pd[user_idx].val = 0;
+    pd[user_idx].KB.read_write = 1;
+    pd[user_idx].KB.usr_or_supervisor = 1;
+    pd[user_idx].KB.page_size = 0;
+    pd[user_idx].KB.base_addr = (uint32_t)user_pt >> 12;
+    pd[user_idx].KB.present = 1;
+    return pd;
+}
+
+/*
+ * free_page_dir
+ *   DESCRIPTION: free a page directory from alloc_page_dir
+ *   INPUTS: pd - the page directory, must not be loaded in cr3
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void free_page_dir(pde_desc_t* pd){
+    if (pd != NULL)
+        free_pages((uint32_t)pd, FRAME_ORDER_4KB);
+}
+
+/* set_process_pd
+ *   DESCRIPTION: switch to the address space of a process, a single cr3 load.
+ *                Global kernel translations survive the switch.
  *   INPUTS: pid - process id
  *   OUTPUTS: none
  *   RETURN VALUE: none
+ *   SIDE EFFECTS: the kernel only directory is loaded if the pid has no process
 */
-void set_user_pt(uint32_t pid) {
-    /* determine the index of user memory in the paging directory */
-    static uint32_t user_idx = USER_MEMORY >> OFFSET_4MB;  
-
-    /* set the pagin parameters */
-    page_directory[user_idx].MB.present = 1;
-    page_directory[user_idx].MB.read_write = 1;
-    page_directory[user_idx].MB.usr_or_supervisor = 1;
-    page_directory[user_idx].MB.page_write_though = 0;
-    page_directory[user_idx].MB.page_cached = 0;
-    page_directory[user_idx].MB.accessed = 0;
-    page_directory[user_idx].MB.dirty = 0;
-    page_directory[user_idx].MB.page_size = 1;
-    page_directory[user_idx].MB.global = 0;
-    page_directory[user_idx].MB.avail = 0;
-    page_directory[user_idx].MB.page_attr_table = 0;
-    page_directory[user_idx].MB.reserved = 0;
-    /* physical address, start from 8MB */
-    page_directory[user_idx].MB.base_addr = (KERNEL_PAGE_END >> OFFSET_4MB) + pid;
-
-    /* flush TLB */
-    flush_tlb();
+void set_process_pd(int32_t pid) {
+    process_crtl_block_t* pcb_ptr = get_pcb(pid);
+    pde_desc_t* pd = (pcb_ptr == NULL) ? page_directory : pcb_ptr->page_dir;
+    asm volatile (
+        "movl %0, %%cr3;"
+        : : "r"(pd) : "memory"
+    );
 }
 
 
 /*
  * flush_tlb
- *   DESCRIPTION: flush TLB when changing process
+ *   DESCRIPTION: flush all non-global TLB entries
  *   INPUTS: none 
  *   OUTPUTS: none
  *   RETURN VALUE: none
@@ -158,44 +209,17 @@ void flush_tlb() {
 }
 
 /*
- * setup_user_vidmem
- *   DESCRIPTION: set up the paging(user page table) for a virtual address space of video
- *   INPUTS: the virtual address for the screen data
- *   OUTPUTS: none
- *   RETURN VALUE: none
- */
-void setup_user_vidmem(uint8_t * vmem){
-    uint32_t pd_idx = (uint32_t)vmem>>22;
-    uint32_t pt_idx = ((uint32_t)vmem & PTE_BASE_MASK)>>12;
-    // clear page directory entry
-    page_directory[pd_idx].val = 0;
-    // customized settings
-    page_directory[pd_idx].KB.page_size = 0;
-    page_directory[pd_idx].KB.usr_or_supervisor = 1;
-    page_directory[pd_idx].KB.read_write = 1;
-    page_directory[pd_idx].KB.base_addr = ((uint32_t)user_page_4K)>>12;
-    // user page table
-    user_page_4K[pt_idx].val = 0;
-    user_page_4K[pt_idx].read_write = 1;
-    user_page_4K[pt_idx].usr_or_supervisor = 1;
-    user_page_4K[pt_idx].base_addr = VID_PT_IDX_BEGIN;
-    user_page_4K[pt_idx].present = 1;
-    // ready to use user level video memory mapping
-    page_directory[pd_idx].KB.present = 1;
-}
-
-/*
- * disable_user_vidmem
- *   DESCRIPTION: clear the paging for the video memory (virtual)
- *   INPUTS: virtual address of screen 
+ * set_vidmem_base
+ *   DESCRIPTION: point the kernel's 0xB8000 page at a physical page
+ *   INPUTS: base - physical page number
  *   OUTPUTS: none
  *   RETURN VALUE: none
  */
-void disable_user_vidmem(uint8_t * vmem){
-    uint32_t pd_idx = (uint32_t)vmem>>22;
-    uint32_t pt_idx = ((uint32_t)vmem & PTE_BASE_MASK)>>12;
-    page_directory[pd_idx].val = 0;
-    user_page_4K[pt_idx].val = 0;
+static void set_vidmem_base(uint32_t base){
+    if (page_table[VID_PT_IDX_BEGIN].base_addr == base)
+        return;
+    page_table[VID_PT_IDX_BEGIN].base_addr = base;
+    invlpg(VIDEO_MEM_BEGIN);
 }
 
 void set_multi_process_vidmem(int32_t flags, uint32_t *arg){
@@ -203,23 +227,20 @@ void set_multi_process_vidmem(int32_t flags, uint32_t *arg){
     int32_t cur_pid_owner_terminal = search_owner_terminal(cur_pid);
     if (flags==VIDMEM_SET_PHYSICAL){
         *arg = page_table[VID_PT_IDX_BEGIN].base_addr;
-        page_table[VID_PT_IDX_BEGIN].base_addr = VID_PT_IDX_BEGIN;
-        flush_tlb();
+        set_vidmem_base(VID_PT_IDX_BEGIN);
         return;
     }
     if (flags==VIDMEM_FORCE_MAPPING && arg!=NULL){
-        page_table[VID_PT_IDX_BEGIN].base_addr = *arg;
-        flush_tlb();
+        set_vidmem_base(*arg);
         return;
     }
     if (cur_pid_owner_terminal != cur_terminal_id){
         uint8_t * cur_vid_buffer = terminal_list[cur_pid_owner_terminal].video_buffer;
-        page_table[VID_PT_IDX_BEGIN].base_addr = (uint32_t)cur_vid_buffer>>12;
+        set_vidmem_base((uint32_t)cur_vid_buffer>>12);
     }
     else{
-        page_table[VID_PT_IDX_BEGIN].base_addr = VID_PT_IDX_BEGIN;
+        set_vidmem_base(VID_PT_IDX_BEGIN);
     }
-    flush_tlb();
 }
 
 // update video memory
@@ -228,84 +249,82 @@ void update_multi_process_vidmem(int32_t terminal_id){
 
     // set_screen_pos(terminal_list[terminal_id].cursor_x, terminal_list[terminal_id].cursor_y);
     uint32_t pt_idx = ((uint32_t)USR_VIDMEM_ADDR & PTE_BASE_MASK)>>12;
+    uint32_t base;
+    process_crtl_block_t* pcb_ptr = get_cur_pcb();
+    // threads share the vidmap page table of their leader
+    if (pcb_ptr != NULL)
+        pcb_ptr = pcb_ptr->leader;
     if(terminal_id == cur_terminal_id)
-    {
-        page_table[VIDEO_MEM_BEGIN>>12].base_addr = VIDEO_MEM_BEGIN>>12;
-        user_page_4K[pt_idx].present = terminal_list[terminal_id].vidmap;
-        user_page_4K[pt_idx].base_addr = VIDEO_MEM_BEGIN>>12;
-    }else{
-        page_table[VIDEO_MEM_BEGIN>>12].base_addr = (uint32_t)terminal_list[terminal_id].video_buffer>>12;
-        user_page_4K[pt_idx].present = terminal_list[terminal_id].vidmap;
-        user_page_4K[pt_idx].base_addr = (uint32_t)terminal_list[terminal_id].video_buffer>>12;
-    }
+        base = VIDEO_MEM_BEGIN>>12;
+    else
+        base = (uint32_t)terminal_list[terminal_id].video_buffer>>12;
+    set_vidmem_base(base);
 
-    flush_tlb();
+    // only the vidmap page of the running process can be in the TLB
+    if (pcb_ptr != NULL && pcb_ptr->vidmap_pt != NULL){
+        pcb_ptr->vidmap_pt[pt_idx].present = terminal_list[terminal_id].vidmap;
+        pcb_ptr->vidmap_pt[pt_idx].base_addr = base;
+        invlpg(USR_VIDMEM_ADDR);
+    }
 }
 
 
-// setup user video memory
-void setup_user_vidmem_for_switch(uint8_t * vmem, uint32_t terminal_offset){
+/*
+ * setup_user_vidmem_for_switch
+ *   DESCRIPTION: map a page of video memory into the current process
+ *   INPUTS: vmem - user virtual address
+ *           terminal_offset - physical address of the screen or terminal buffer
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 for success, -1 if the page table can't be allocated
+ */
+int32_t setup_user_vidmem_for_switch(uint8_t * vmem, uint32_t terminal_offset){
     uint32_t pd_idx = (uint32_t)vmem>>22;
     uint32_t pt_idx = ((uint32_t)vmem & PTE_BASE_MASK)>>12;
+    process_crtl_block_t* pcb_ptr = get_cur_pcb();
+    if (pcb_ptr == NULL)
+        return FAILURE;
+    pcb_ptr = pcb_ptr->leader;
+    // every process gets its own vidmap page table on first use
+    if (pcb_ptr->vidmap_pt == NULL){
+        pcb_ptr->vidmap_pt = (pte_desc_t*)alloc_pages(FRAME_ORDER_4KB);
+        if (pcb_ptr->vidmap_pt == NULL)
+            return FAILURE;
+        memset(pcb_ptr->vidmap_pt, 0, PAGE_SIZE_4K);
+    }
     // clear page directory entry
-    page_directory[pd_idx].val = 0;
+    pcb_ptr->page_dir[pd_idx].val = 0;
     // customized settings
-    page_directory[pd_idx].KB.page_size = 0;
-    page_directory[pd_idx].KB.usr_or_supervisor = 1;
-    page_directory[pd_idx].KB.read_write = 1;
-    page_directory[pd_idx].KB.base_addr = ((uint32_t)user_page_4K)>>12;
+    pcb_ptr->page_dir[pd_idx].KB.page_size = 0;
+    pcb_ptr->page_dir[pd_idx].KB.usr_or_supervisor = 1;
+    pcb_ptr->page_dir[pd_idx].KB.read_write = 1;
+    pcb_ptr->page_dir[pd_idx].KB.base_addr = ((uint32_t)pcb_ptr->vidmap_pt)>>12;
     // user page table
-    user_page_4K[pt_idx].val = 0;
-    user_page_4K[pt_idx].read_write = 1;
-    user_page_4K[pt_idx].usr_or_supervisor = 1;
-    user_page_4K[pt_idx].base_addr = terminal_offset>>12;
-    user_page_4K[pt_idx].present = 1;
+    pcb_ptr->vidmap_pt[pt_idx].val = 0;
+    pcb_ptr->vidmap_pt[pt_idx].read_write = 1;
+    pcb_ptr->vidmap_pt[pt_idx].usr_or_supervisor = 1;
+    pcb_ptr->vidmap_pt[pt_idx].base_addr = terminal_offset>>12;
+    pcb_ptr->vidmap_pt[pt_idx].present = 1;
     // ready to use user level video memory mapping
-    page_directory[pd_idx].KB.present = 1;
+    pcb_ptr->page_dir[pd_idx].KB.present = 1;
+    invlpg((uint32_t)vmem);
+    return SUCCESS;
 }
 
+/*
+ * close_user_vidmem_for_switch
+ *   DESCRIPTION: unmap the video memory page of the current process
+ *   INPUTS: vmem - user virtual address
+ *           terminal_offset - physical address it was mapped to
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
 void close_user_vidmem_for_switch(uint8_t * vmem, uint32_t terminal_offset){
-    uint32_t pd_idx = (uint32_t)vmem>>22;
     uint32_t pt_idx = ((uint32_t)vmem & PTE_BASE_MASK)>>12;
-    // clear page directory entry
-    page_directory[pd_idx].val = 0;
-    // customized settings
-    page_directory[pd_idx].KB.page_size = 0;
-    page_directory[pd_idx].KB.usr_or_supervisor = 1;
-    page_directory[pd_idx].KB.read_write = 1;
-    page_directory[pd_idx].KB.base_addr = ((uint32_t)user_page_4K)>>12;
-    // user page table
-    user_page_4K[pt_idx].val = 0;
-    user_page_4K[pt_idx].read_write = 1;
-    user_page_4K[pt_idx].usr_or_supervisor = 1;
-    user_page_4K[pt_idx].base_addr = terminal_offset>>12;
-    user_page_4K[pt_idx].present = 0;
-    // ready to use user level video memory mapping
-    page_directory[pd_idx].KB.present = 1;
-}
-
-// close user video memory (pd)
-void close_user_vidmem(uint8_t * vmem){
-    uint32_t pd_idx = (uint32_t)vmem>>22;
-    uint32_t pt_idx = ((uint32_t)vmem & PTE_BASE_MASK)>>12;
-    // clear page directory entry
-    page_directory[pd_idx].val = 0;
-    // customized settings
-    page_directory[pd_idx].KB.page_size = 0;
-    page_directory[pd_idx].KB.usr_or_supervisor = 1;
-    page_directory[pd_idx].KB.read_write = 1;
-    page_directory[pd_idx].KB.base_addr = ((uint32_t)user_page_4K)>>12;
-    // user page table
-    user_page_4K[pt_idx].val = 0;
-    user_page_4K[pt_idx].read_write = 1;
-    user_page_4K[pt_idx].usr_or_supervisor = 1;
-    user_page_4K[pt_idx].base_addr = page_table[pt_idx].base_addr;
-    user_page_4K[pt_idx].present = 0;
-    // ready to use user level video memory mapping
-    page_directory[pd_idx].KB.present = 1;
+    process_crtl_block_t* pcb_ptr = get_cur_pcb();
+    if (pcb_ptr == NULL || pcb_ptr->leader->vidmap_pt == NULL)
+        return;
+    pcb_ptr = pcb_ptr->leader;
+    pcb_ptr->vidmap_pt[pt_idx].base_addr = terminal_offset>>12;
+    pcb_ptr->vidmap_pt[pt_idx].present = 0;
+    invlpg((uint32_t)vmem);
 }
-
-
-
-
-
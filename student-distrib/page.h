@@ -2,6 +2,7 @@
 #define _PAGE_H
 
 #include "types.h"
+#include "x86_desc.h"
 
 #define KERNEL_PAGE_BEGIN 0x400000
 #define VIDEO_MEM_BEGIN 0x0B8000 
@@ -15,13 +16,24 @@
 
 void init_paging();
 
-void set_user_pt(uint32_t pid);
+pde_desc_t* alloc_page_dir(pte_desc_t* user_pt);
 
-void flush_tlb();
+void free_page_dir(pde_desc_t* pd);
+
+void set_process_pd(int32_t pid);
 
-void setup_user_vidmem(uint8_t * vmem);
+void flush_tlb();
 
-void disable_user_vidmem(uint8_t * vmem);
+/*
+ * invlpg
+ *   DESCRIPTION: drop the TLB entry of one page, global or not
+ *   INPUTS: addr - virtual address inside the page
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static inline void invlpg(uint32_t addr){
+    asm volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+}
 
 #define VIDMEM_SET_PHYSICAL     1
 #define VIDMEM_FORCE_MAPPING    2
@@ -29,9 +41,7 @@ void set_multi_process_vidmem(int32_t flags, uint32_t *arg);
 
 void update_multi_process_vidmem(int32_t terminal_id);
 
-void setup_user_vidmem_for_switch(uint8_t * vmem, uint32_t terminal_offset);
+int32_t setup_user_vidmem_for_switch(uint8_t * vmem, uint32_t terminal_offset);
 
 void close_user_vidmem_for_switch(uint8_t * vmem, uint32_t terminal_offset);
-
-void close_user_vidmem(uint8_t * vmem);
 #endif
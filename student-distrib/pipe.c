@@ -0,0 +1,178 @@
+#include "pipe.h"
+#include "lib.h"
+#include "futex.h"
+#include "memory/slab.h"
+
+#define PIPE_MASK   (PIPE_BUF_SIZE - 1)
+
+// readers sleep on the head counter, writers on the tail counter
+#define PIPE_READ_KEY(p)    ((uint32_t)&(p)->head)
+#define PIPE_WRITE_KEY(p)   ((uint32_t)&(p)->tail)
+
+static file_ops_table_t pipe_read_ops = {NULL, pipe_close_read, NULL, pipe_read};
+static file_ops_table_t pipe_write_ops = {NULL, pipe_close_write, pipe_write, NULL};
+
+static kmem_cache_t pipe_cache;
+
+static void pipe_release(pipe_t* p);
+
+/*
+ * pipe_init
+ *   DESCRIPTION: set up the cache pipes are allocated from
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void pipe_init(void){
+    kmem_cache_init(&pipe_cache, "pipe", sizeof(pipe_t), NULL);
+}
+
+/*
+ * pipe_create
+ *   DESCRIPTION: make a new pipe and fill in both of its open files
+ *   INPUTS: read_end, write_end - new files from file_alloc
+ *   OUTPUTS: the files now refer to the pipe
+ *   RETURN VALUE: 0 for success, -1 if out of memory
+ */
+int32_t pipe_create(file_desc_entry_t* read_end, file_desc_entry_t* write_end){
+    pipe_t* p = (pipe_t*)kmem_cache_alloc(&pipe_cache);
+    if (p == NULL)
+        return FAILURE;
+    p->head = 0;
+    p->tail = 0;
+    p->readers = 1;
+    p->writers = 1;
+
+    read_end->file_op = pipe_read_ops;
+    read_end->inode = (int32_t)p;
+    read_end->file_pos = 0;
+    read_end->flags = FILE_FLAG_IN_USE;
+    write_end->file_op = pipe_write_ops;
+    write_end->inode = (int32_t)p;
+    write_end->file_pos = 0;
+    write_end->flags = FILE_FLAG_IN_USE;
+    return SUCCESS;
+}
+
+/*
+ * pipe_read
+ *   DESCRIPTION: read from a pipe, sleeping while it is empty
+ *   INPUTS: inode - the pipe
+ *           offset - unused
+ *           buf - user buffer
+ *           nbytes - most bytes to read
+ *   OUTPUTS: buf
+ *   RETURN VALUE: bytes read, 0 at end of file once every writer closed,
+ *                 -1 if a signal ended the wait
+ */
+int32_t pipe_read(int32_t inode, uint32_t* offset, void* buf, int32_t nbytes){
+    pipe_t* p = (pipe_t*)inode;
+    uint32_t flags;
+    int32_t i, cnt;
+    if (buf == NULL || nbytes < 0)
+        return FAILURE;
+
+    cli_and_save(flags);
+    while (p->head == p->tail && p->writers > 0){
+        if (futex_sleep(PIPE_READ_KEY(p)) != SUCCESS){
+            restore_flags(flags);
+            return FAILURE;
+        }
+    }
+    cnt = p->head - p->tail;
+    if (cnt > nbytes)
+        cnt = nbytes;
+    for (i = 0; i < cnt; i++)
+        ((uint8_t*)buf)[i] = p->buf[(p->tail + i) & PIPE_MASK];
+    p->tail += cnt;
+    if (cnt > 0)
+        futex_wake_key(PIPE_WRITE_KEY(p), PID_MAX);
+    restore_flags(flags);
+    return cnt;
+}
+
+/*
+ * pipe_write
+ *   DESCRIPTION: write everything into a pipe, sleeping while it is full
+ *   INPUTS: inode - the pipe
+ *           buf - user buffer
+ *           nbytes - bytes to write
+ *   OUTPUTS: none
+ *   RETURN VALUE: bytes written, -1 if every reader closed or a signal came
+ *                 before any byte went in
+ */
+int32_t pipe_write(int32_t inode, const void* buf, int32_t nbytes){
+    pipe_t* p = (pipe_t*)inode;
+    uint32_t flags;
+    int32_t done = 0;
+    if (buf == NULL || nbytes < 0)
+        return FAILURE;
+
+    cli_and_save(flags);
+    while (done < nbytes && p->readers > 0){
+        if (p->head - p->tail == PIPE_BUF_SIZE){
+            // a signal keeps what is written so far
+            if (futex_sleep(PIPE_WRITE_KEY(p)) != SUCCESS)
+                break;
+            continue;
+        }
+        // copy as much as fits, readers can start on it right away
+        while (done < nbytes && p->head - p->tail < PIPE_BUF_SIZE){
+            p->buf[p->head & PIPE_MASK] = ((const uint8_t*)buf)[done];
+            p->head++;
+            done++;
+        }
+        futex_wake_key(PIPE_READ_KEY(p), PID_MAX);
+    }
+    restore_flags(flags);
+    return (done == 0 && nbytes > 0) ? FAILURE : done;
+}
+
+/*
+ * pipe_close_read
+ *   DESCRIPTION: drop a read end, writers see -1 once the last one is gone
+ *   INPUTS: inode_ptr - points at the pipe
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0
+ */
+int32_t pipe_close_read(int32_t* inode_ptr){
+    pipe_t* p = (pipe_t*)*inode_ptr;
+    uint32_t flags;
+    cli_and_save(flags);
+    p->readers--;
+    futex_wake_key(PIPE_WRITE_KEY(p), PID_MAX);
+    pipe_release(p);
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ * pipe_close_write
+ *   DESCRIPTION: drop a write end, readers see end of file once the last
+ *                one is gone
+ *   INPUTS: inode_ptr - points at the pipe
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0
+ */
+int32_t pipe_close_write(int32_t* inode_ptr){
+    pipe_t* p = (pipe_t*)*inode_ptr;
+    uint32_t flags;
+    cli_and_save(flags);
+    p->writers--;
+    futex_wake_key(PIPE_READ_KEY(p), PID_MAX);
+    pipe_release(p);
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ * pipe_release
+ *   DESCRIPTION: free the pipe once both sides are closed
+ *   INPUTS: p - the pipe
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void pipe_release(pipe_t* p){
+    if (p->readers == 0 && p->writers == 0)
+        kmem_cache_free(&pipe_cache, p);
+}
@@ -0,0 +1,28 @@
+#ifndef _PIPE_H
+#define _PIPE_H
+
+#include "types.h"
+#include "filesystem/filesys.h"
+
+/* a pipe and its ring buffer are one object of the pipe cache */
+#define PIPE_BUF_SIZE       2048
+
+typedef struct pipe {
+    // free running counters, head - tail bytes are buffered
+    uint32_t head;
+    uint32_t tail;
+    // open files for each end, the pipe goes away when both reach 0
+    int32_t readers;
+    int32_t writers;
+    uint8_t buf[PIPE_BUF_SIZE];
+} pipe_t;
+
+void pipe_init(void);
+int32_t pipe_create(file_desc_entry_t* read_end, file_desc_entry_t* write_end);
+
+int32_t pipe_read(int32_t inode, uint32_t* offset, void* buf, int32_t nbytes);
+int32_t pipe_write(int32_t inode, const void* buf, int32_t nbytes);
+int32_t pipe_close_read(int32_t* inode_ptr);
+int32_t pipe_close_write(int32_t* inode_ptr);
+
+#endif /* _PIPE_H */
@@ -3,21 +3,22 @@
 
 #include "types.h"
 #include "filesystem/filesys.h"
+#include "filesystem/file.h"
 #include "x86_desc.h"
+#include "memory/frame.h"
+#include "ktimer.h"
 
-#define MAX_PROCESS_NUM         6
-#define MAX_PROCESS_FILE_NUM    8
 #define MAX_COMMEND_ARG         128
 
 
 #define KERNEL_PAGE_END     0x800000
-#define KERNEL_STACK_SIZE   0x2000
+#define KERNEL_STACK_SIZE   KSTACK_SIZE
 
 #define USER_MEMORY         0x08000000
 #define USER_STACK_SIZE     0x400000
 #define USER_OFFSET         4
+#define USER_EFLAGS         0x200
 #define KERNEL_STACK_OFFSET 4
-#define BEGIN_OFFSET        24
 #define OFFSET_4MB          22
 
 #define FAILURE         -1
@@ -28,12 +29,25 @@
 #define UNOCCUPIED      0
 #define RUNNING         1
 #define NOT_RUNNING     0
+#define ZOMBIE          2
+
+// pids are handed out in increasing order and wrap around at PID_MAX
+#define PID_MAX         32768
+#define PID_HASH_SIZE   64
+
+// shared memory segments one process can have attached
+#define SHM_PER_PROCESS 4
 
 #define MEMORY_LEAK 4
 #define TIMER_BUF_LEN   20
 
 #define VIRTUAL_MEMORY_BASE_ADDRESS 0x8048000
 #define VIRTUAL_MEMORY_END_ADDRESS  0x8400000
+/* shared user runtime, mapped below the program when the file exists */
+#define RUNTIME_BASE_ADDRESS        0x8000000
+#define RUNTIME_NAME                "libece391"
+/* read-only time page, the last page below the program */
+#define TIME_PAGE_ADDRESS           (VIRTUAL_MEMORY_BASE_ADDRESS - FRAME_SIZE)
 #define EIP_OFFSET  24
 
 
@@ -67,17 +81,29 @@ typedef struct sig_stack{
     uint8_t sigreturn[8];
 }sig_stack;
 
+/* signals fit one bit each in a 32 bit set */
+#define NUM_SIGNAL 32
+
 typedef struct{
     int32_t signum;
     signal_handler sig_handler;
-    uint8_t mask;
-    uint8_t pending;
-    uint32_t alarm_time;
 }signal_struct;
 
 
 
-typedef struct {
+typedef struct{
+    int32_t id;
+    uint32_t addr;
+}shm_attach_t;
+
+typedef struct process_crtl_block {
+    // one bit per signal: raised and not handled yet, and held back. They
+    // come first, the trap return path tests them at PCB_SIG_PENDING and
+    // PCB_SIG_BLOCKED (asm_linkage.h)
+    uint32_t sig_pending;
+    uint32_t sig_blocked;
+    // blocked set from before the running user handler, for sigreturn
+    uint32_t sig_saved_blocked;
     // process id for this pcb
     int32_t pid;
     // parent pid
@@ -88,26 +114,56 @@ typedef struct {
     // vidmem
     uint16_t use_vidmem;
     uint8_t *vmem;
+    // program entry point, from the ELF header
+    uint32_t entry;
+    // heap from sbrk, [heap_start, brk) is filled with zero pages on first touch
+    uint32_t heap_start;
+    uint32_t brk;
     // current pos on stack
     uint32_t esp;
     uint32_t ebp;
     // stack switch address
     uint32_t tss_esp0;
-    // file descriptor array
-    file_desc_entry_t fda[MAX_PROCESS_FILE_NUM];
+    // file descriptor table, grows past its inline slots on demand
+    fd_table_t files;
     // signal struct
-    signal_struct sig[5];
-    uint32_t alarm_time;
+    signal_struct sig[NUM_SIGNAL];
+    // raises ALARM, every alarm_period ticks or once if it is 0
+    ktimer_t alarm_timer;
+    uint32_t alarm_period;
+    // wakes the thread out of sleep_ms
+    ktimer_t sleep_timer;
     // create time
     char create_time[TIMER_BUF_LEN];
-}process_crtl_block_t;
-
-typedef struct {
+    // scheduling state
     uint8_t status;
     uint8_t is_running;
-    int32_t pid;
     int32_t terminal_id;
-} process_map_t;
+    // 1 if the parent sits in execute until we halt
+    uint8_t parent_waiting;
+    // 1 for the shell a terminal starts with, halting it restarts the shell
+    uint8_t terminal_root;
+    // address space: 4KB user pages, the vidmap page table is allocated on
+    // first vidmap
+    pde_desc_t* page_dir;
+    pte_desc_t* user_pt;
+    pte_desc_t* vidmap_pt;
+    // thread group: the leader owns the address space, the vidmap page and
+    // the fd table, the other threads point at them
+    struct process_crtl_block* leader;
+    fd_table_t* fd_table;
+    // thread sleeping in thread_join on us, and our thread_exit status
+    struct process_crtl_block* join_waiter;
+    int32_t exit_status;
+    // attached shared memory, id -1 for a free slot
+    shm_attach_t shm[SHM_PER_PROCESS];
+    // futex we sleep on (physical address, 0 if none) and its hash chain
+    uint32_t futex_key;
+    struct process_crtl_block* futex_next;
+    // all processes, and the chain of the pid hash bucket
+    struct process_crtl_block* next;
+    struct process_crtl_block* hash_next;
+}process_crtl_block_t;
 
 #define ONTO_DISPLAY_WRAP(code) {               \
     video_mem = (char*) 0xb7000;   \
@@ -117,7 +173,7 @@ typedef struct {
 
 extern int32_t cur_pid;
 extern int32_t cur_terminal_id;
-extern process_map_t process_map[MAX_PROCESS_NUM];
+extern process_crtl_block_t* process_list;
 
 void init_fda(int32_t request_pid);
 
@@ -131,16 +187,31 @@ process_crtl_block_t * get_pcb(int32_t request_pid);
 
 process_crtl_block_t* create_PCB(int32_t next_pid, int8_t* arg, int32_t flags);
 
-int load_file_tomemory(const uint8_t* fname);
+process_crtl_block_t* clone_PCB(int32_t child_pid, process_crtl_block_t* parent_pcb);
+
+int load_file_tomemory(const uint8_t* fname, process_crtl_block_t* pcb_ptr);
 
 int32_t allocate_process(void);
 
+int32_t allocate_thread(process_crtl_block_t* leader_pcb);
+
+process_crtl_block_t* create_thread_PCB(int32_t tid, process_crtl_block_t* cur_pcb, uint32_t entry, uint32_t user_esp);
+
+void exit_threads(process_crtl_block_t* leader_pcb);
+
+void prepare_user_return(process_crtl_block_t* pcb_ptr, sig_regs* regs);
+
 void free_process(int32_t pid);
 
 int32_t search_process(int32_t terminal_id);
+int32_t search_foreground(int32_t terminal_id);
 
 int32_t search_owner_terminal(int32_t request_pid);
 
 void process_switch();
 
+void process_wait();
+
+void process_exit_switch();
+
 #endif
@@ -8,20 +8,34 @@
 #include "devices/keyboard.h"
 #include "timer.h"
 #include "signal.h"
+#include "memory/vm.h"
+#include "futex.h"
+#include "pipe.h"
+#include "memory/shm.h"
+#include "memory/image.h"
+#include "elf.h"
+#include "devices/pit.h"
+#include "softirq.h"
 
 // static helper function
 static void _init_fda(process_crtl_block_t* pcb_ptr);
-static int32_t round_robin_next_pid(int32_t cur_pid_owner_terminal);
+static process_crtl_block_t* round_robin_next(process_crtl_block_t* cur_pcb_ptr);
+static void switch_to_process(process_crtl_block_t* next_pcb_ptr);
+static void reap_zombies(void);
+static void link_process(process_crtl_block_t* pcb_ptr, int32_t pid);
+static int32_t alloc_pid(void);
+static void map_runtime(process_crtl_block_t* pcb_ptr);
+
+#define PID_HASH(pid)   ((pid) & (PID_HASH_SIZE - 1))
 
 // global variable
 int32_t cur_pid = NULL_PROCESS;
 int32_t cur_terminal_id = DEFAULT_TERMINAL;
-process_map_t process_map[MAX_PROCESS_NUM] = {{UNOCCUPIED, NOT_RUNNING, NULL_PROCESS, DEFAULT_TERMINAL},
-                                              {UNOCCUPIED, NOT_RUNNING, NULL_PROCESS, DEFAULT_TERMINAL},
-                                              {UNOCCUPIED, NOT_RUNNING, NULL_PROCESS, DEFAULT_TERMINAL},
-                                              {UNOCCUPIED, NOT_RUNNING, NULL_PROCESS, DEFAULT_TERMINAL},
-                                              {UNOCCUPIED, NOT_RUNNING, NULL_PROCESS, DEFAULT_TERMINAL},
-                                              {UNOCCUPIED, NOT_RUNNING, NULL_PROCESS, DEFAULT_TERMINAL}};
+process_crtl_block_t* process_list = NULL;
+
+// pid -> pcb lookup, pcbs no longer sit at a fixed place per pid
+static process_crtl_block_t* pid_hash[PID_HASH_SIZE];
+static int32_t next_free_pid = 0;
 
 /*
  * init_fda
@@ -43,36 +57,71 @@ void init_fda(int32_t request_pid){
  *   RETURN VALUE: None
  */
 static void _init_fda(process_crtl_block_t* pcb_ptr){
-    int32_t i;
-    for (i=0; i<MAX_PROCESS_FILE_NUM; i++){
-        pcb_ptr->fda[i].file_op = empty_op;
-        pcb_ptr->fda[i].inode = 0;
-        pcb_ptr->fda[i].file_pos = 0;
-        pcb_ptr->fda[i].flags = FILE_FLAG_FREE;
+    file_desc_entry_t* stdin_file;
+    file_desc_entry_t* stdout_file;
+    fd_table_destroy(pcb_ptr->fd_table);
+    stdin_file = file_alloc();
+    stdout_file = file_alloc();
+    if (stdin_file != NULL){
+        stdin_file->file_op = get_stdin_ops();
+        fd_set(pcb_ptr->fd_table, 0, stdin_file);
+    }
+    if (stdout_file != NULL){
+        stdout_file->file_op = get_stdout_ops();
+        fd_set(pcb_ptr->fd_table, 1, stdout_file);
     }
-    pcb_ptr->fda[0].file_op = get_stdin_ops();
-    pcb_ptr->fda[0].flags = FILE_FLAG_IN_USE;
-    pcb_ptr->fda[1].file_op = get_stdout_ops();
-    pcb_ptr->fda[1].flags = FILE_FLAG_IN_USE;
     terminal_open();
 }
 
 /* load_file_tomemory
- *   DESCRIPTION: load the file into user memory          
+ *   DESCRIPTION: map the loadable segments of a program into user memory
  *   INPUTS: fname - file name
+ *           pcb_ptr - process whose address space receives the image, its
+ *                     page directory must be the live one
  *   OUTPUTS: none
- *   RETURN VALUE: 1 for success
- *                 0 for fail
+ *   RETURN VALUE: 0 for success
+ *                 -1 for fail
+ *   SIDE EFFECTS: sets the entry point in the pcb
 */
-int load_file_tomemory(const uint8_t* fname){
+int load_file_tomemory(const uint8_t* fname, process_crtl_block_t* pcb_ptr){
     dentry_t dir_dentry;
     inode_blk_t* temp_inode;
     if (read_dentry_by_name((char*)fname, &dir_dentry) == FAILURE) return FAILURE;          // load the parameter of dir_dentry by the file name
     temp_inode = (inode_blk_t*)fs_start_ptr + 1 + dir_dentry.inode;                         // get the pointer of the inode
-    read_data(dir_dentry.inode, 0, (char*)VIRTUAL_MEMORY_BASE_ADDRESS, temp_inode->size);   // load the whole memory to the defined address
+    // the file pages are shared with other instances of the program, bss
+    // and stack are filled with zero pages on first touch
+    if (elf_load(dir_dentry.inode, temp_inode->size, pcb_ptr->user_pt, &pcb_ptr->entry, &pcb_ptr->heap_start) == FAILURE)
+        return FAILURE;
+    // the heap starts empty on the page after the program
+    pcb_ptr->heap_start = (pcb_ptr->heap_start + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+    pcb_ptr->brk = pcb_ptr->heap_start;
+    map_runtime(pcb_ptr);
+    if (time_map(pcb_ptr->user_pt) == FAILURE)
+        return FAILURE;
     return SUCCESS;
 }
 
+/* map_runtime
+ *   DESCRIPTION: map the shared user runtime below the program. Programs
+ *                built against it call the library through its jump table,
+ *                statically linked programs never touch it.
+ *   INPUTS: pcb_ptr - process being loaded
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: nothing is mapped if the runtime file is missing or does
+ *                 not fit below the program
+*/
+static void map_runtime(process_crtl_block_t* pcb_ptr){
+    dentry_t dir_dentry;
+    inode_blk_t* temp_inode;
+    if (read_dentry_by_name(RUNTIME_NAME, &dir_dentry) == FAILURE)
+        return;
+    temp_inode = (inode_blk_t*)fs_start_ptr + 1 + dir_dentry.inode;
+    if (temp_inode->size > TIME_PAGE_ADDRESS - RUNTIME_BASE_ADDRESS)
+        return;
+    image_map(pcb_ptr->user_pt, dir_dentry.inode, temp_inode->size, 0, RUNTIME_BASE_ADDRESS, temp_inode->size, 1);
+}
+
 /* create_PCB
  *   DESCRIPTION: initialize the new pcb and set the parameters          
  *   INPUTS: next_pid - the pid of the pcb
@@ -84,17 +133,124 @@ process_crtl_block_t* create_PCB(int32_t next_pid, int8_t* args, int32_t flags){
     process_crtl_block_t* next_pcb_ptr = get_pcb(next_pid);         // get the pcb pointer
     next_pcb_ptr->pid = next_pid;                                   // set the parameter
     next_pcb_ptr->parent_pid = (flags==PROCESS_FORK) ? cur_pid : NULL_PROCESS;
-    next_pcb_ptr->alarm_time = 0;
+    next_pcb_ptr->parent_waiting = (flags==PROCESS_FORK);
+    next_pcb_ptr->terminal_root = (flags==PROCESS_NO_FORK);
+    next_pcb_ptr->use_vidmem = 0;
+    next_pcb_ptr->vmem = NULL;
 
     _init_fda(next_pcb_ptr);                                        // initialize the fd array
     sig_init(next_pcb_ptr);
-    next_pcb_ptr->tss_esp0 = KERNEL_PAGE_END-KERNEL_STACK_SIZE*next_pid-KERNEL_STACK_OFFSET;    // store the tss-esp0
+    alarm_start(next_pcb_ptr);
+    next_pcb_ptr->tss_esp0 = (uint32_t)next_pcb_ptr+KERNEL_STACK_SIZE-KERNEL_STACK_OFFSET;      // store the tss-esp0
     strncpy((int8_t*)next_pcb_ptr->cmd_arg, (int8_t*)(args), MAX_COMMEND_ARG);                  // copy the argument string to the pcb
     uint32_t i = 0;
     cmos_read(0, &i, next_pcb_ptr->create_time, TIMER_BUF_LEN);
     return next_pcb_ptr;
 }
 
+/* clone_PCB
+ *   DESCRIPTION: fill the pcb of a fork child from its parent: fds, signal
+ *                state and command are copied, the user pages are shared
+ *                copy-on-write
+ *   INPUTS: child_pid - pid from allocate_process
+ *           parent_pcb - the forking process, must be the current one
+ *   OUTPUTS: none
+ *   RETURN VALUE: the child pcb pointer, NULL if the fd table cannot be
+ *                 copied
+ *   SIDE EFFECTS: the parent's writable pages turn read-only, flushes the TLB
+*/
+process_crtl_block_t* clone_PCB(int32_t child_pid, process_crtl_block_t* parent_pcb){
+    process_crtl_block_t* child_pcb = get_pcb(child_pid);
+    uint32_t i = 0;
+    // the child shares every open file, and its position, with the parent
+    if (fd_table_copy(child_pcb->fd_table, parent_pcb->fd_table) == FAILURE)
+        return NULL;
+    child_pcb->parent_pid = parent_pcb->pid;
+    child_pcb->parent_waiting = 0;
+    child_pcb->terminal_id = parent_pcb->terminal_id;
+    child_pcb->heap_start = parent_pcb->leader->heap_start;
+    child_pcb->brk = parent_pcb->leader->brk;
+    // the vidmap page table is per process, the child maps it again if needed
+    child_pcb->use_vidmem = 0;
+    child_pcb->vmem = NULL;
+    memcpy(child_pcb->cmd, parent_pcb->cmd, MAX_COMMEND_ARG);
+    memcpy(child_pcb->cmd_arg, parent_pcb->cmd_arg, MAX_COMMEND_ARG);
+    memcpy(child_pcb->sig, parent_pcb->sig, sizeof(parent_pcb->sig));
+    // handlers and the blocked set carry over, nothing is pending yet
+    child_pcb->sig_pending = 0;
+    child_pcb->sig_blocked = parent_pcb->sig_blocked;
+    child_pcb->sig_saved_blocked = 0;
+    alarm_start(child_pcb);
+    child_pcb->tss_esp0 = (uint32_t)child_pcb+KERNEL_STACK_SIZE-KERNEL_STACK_OFFSET;
+    cmos_read(0, &i, child_pcb->create_time, TIMER_BUF_LEN);
+
+    vm_share_cow(child_pcb->user_pt, parent_pcb->user_pt);
+    shm_fork(child_pcb, parent_pcb);
+    // parent entries just lost their write bit
+    flush_tlb();
+    return child_pcb;
+}
+
+/* create_thread_PCB
+ *   DESCRIPTION: fill the pcb of a new thread. It shares the address space
+ *                and fds of its process and starts in user mode at entry
+ *                on its own stack.
+ *   INPUTS: tid - pid from allocate_thread
+ *           cur_pcb - the creating thread, must be the current one
+ *           entry - user eip of the thread
+ *           user_esp - top of the thread's user stack
+ *   OUTPUTS: none
+ *   RETURN VALUE: the thread pcb pointer
+*/
+process_crtl_block_t* create_thread_PCB(int32_t tid, process_crtl_block_t* cur_pcb, uint32_t entry, uint32_t user_esp){
+    process_crtl_block_t* thread_pcb = get_pcb(tid);
+    sig_regs regs;
+    uint32_t i = 0;
+    thread_pcb->parent_pid = cur_pcb->leader->pid;
+    thread_pcb->terminal_id = cur_pcb->terminal_id;
+    thread_pcb->use_vidmem = 0;
+    thread_pcb->vmem = NULL;
+    memcpy(thread_pcb->cmd, cur_pcb->cmd, MAX_COMMEND_ARG);
+    memcpy(thread_pcb->cmd_arg, cur_pcb->cmd_arg, MAX_COMMEND_ARG);
+    memcpy(thread_pcb->sig, cur_pcb->sig, sizeof(cur_pcb->sig));
+    thread_pcb->sig_pending = 0;
+    thread_pcb->sig_blocked = cur_pcb->sig_blocked;
+    thread_pcb->sig_saved_blocked = 0;
+    alarm_start(thread_pcb);
+    thread_pcb->tss_esp0 = (uint32_t)thread_pcb+KERNEL_STACK_SIZE-KERNEL_STACK_OFFSET;
+    cmos_read(0, &i, thread_pcb->create_time, TIMER_BUF_LEN);
+
+    // same segments and flags as the creator, fresh registers
+    regs = *(sig_regs*)(cur_pcb->tss_esp0 - sizeof(sig_regs));
+    regs.ebx = regs.ecx = regs.edx = regs.esi = regs.edi = 0;
+    regs.ebp = regs.eax = 0;
+    regs.eip = entry;
+    regs.useresp = user_esp;
+    prepare_user_return(thread_pcb, &regs);
+    return thread_pcb;
+}
+
+/* prepare_user_return
+ *   DESCRIPTION: set up the kernel stack of a new pcb so that its first
+ *                schedule returns to user mode with the given registers
+ *   INPUTS: pcb_ptr - pcb that has never run
+ *           regs - user context to iret to
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+*/
+void prepare_user_return(process_crtl_block_t* pcb_ptr, sig_regs* regs){
+    sig_regs* stack_regs = (sig_regs*)(pcb_ptr->tss_esp0 - sizeof(sig_regs));
+    uint32_t* frame;
+    *stack_regs = *regs;
+    // fake frame for jump_to_next_process: leave pops ebp, ret goes to
+    // fork_child_return which irets with the context above
+    frame = (uint32_t*)stack_regs - 2;
+    frame[0] = 0;
+    frame[1] = (uint32_t)fork_child_return;
+    pcb_ptr->esp = (uint32_t)frame;
+    pcb_ptr->ebp = (uint32_t)frame;
+}
+
 /*
  * save_iret_context
  *   DESCRIPTION: change the tss to kernel space with new pcb. This helper function will help us finish this step and store the content
@@ -118,9 +274,8 @@ void save_iret_context(process_crtl_block_t* cur_pcb_ptr)
     uint32_t cur_ESP = USER_MEMORY + USER_STACK_SIZE - USER_OFFSET;
     uint32_t SS = USER_DS;
 
-    // find the content of eip
-    uint8_t* entry_pointer = (uint8_t* ) VIRTUAL_MEMORY_BASE_ADDRESS+BEGIN_OFFSET; //store a pointer in this place, for next instruction.
-    uint32_t cur_EIP = *(uint32_t*)entry_pointer; //get the content of this pointer, load 24-27 bytes
+    // entry point from the ELF header
+    uint32_t cur_EIP = cur_pcb_ptr->entry;
     
     sti();
 
@@ -148,53 +303,198 @@ void save_iret_context(process_crtl_block_t* cur_pcb_ptr)
 process_crtl_block_t * get_cur_pcb(){
     if (cur_pid==NULL_PROCESS)      
         return NULL;         
-    return (process_crtl_block_t *)(KERNEL_PAGE_END-KERNEL_STACK_SIZE*(cur_pid+1));
+    return get_pcb(cur_pid);
 }
 
 /* get_pcb
  *   DESCRIPTION: get the process pcb  pointer using the pid number       
  *   INPUTS: pid number
  *   OUTPUTS: 
- *   RETURN VALUE: the pcb pointer
+ *   RETURN VALUE: the pcb pointer, NULL if no such process
 */
 process_crtl_block_t * get_pcb(int32_t request_pid){
-    if (request_pid<0|| request_pid >= MAX_PROCESS_NUM)
+    process_crtl_block_t* pcb_ptr;
+    if (request_pid<0 || request_pid>=PID_MAX)
         return NULL;
-    return (process_crtl_block_t *)(KERNEL_PAGE_END-KERNEL_STACK_SIZE*(request_pid+1));
+    for (pcb_ptr = pid_hash[PID_HASH(request_pid)]; pcb_ptr != NULL; pcb_ptr = pcb_ptr->hash_next){
+        if (pcb_ptr->pid == request_pid)
+            return pcb_ptr;
+    }
+    return NULL;
+}
+
+/* alloc_pid
+ *   DESCRIPTION: find the next pid that is not in use
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: free pid, -1 if every pid is taken
+*/
+static int32_t alloc_pid(void){
+    int32_t i, pid;
+    for (i = 0; i < PID_MAX; i++){
+        pid = next_free_pid;
+        next_free_pid = (next_free_pid + 1) % PID_MAX;
+        if (get_pcb(pid) == NULL)
+            return pid;
+    }
+    return FAILURE;
 }
 
 /* allocate_process
- *   DESCRIPTION: allocate one new process
+ *   DESCRIPTION: allocate one new process, its kernel stack (pcb at the bottom)
+ *                and the page table for its user space
  *   INPUTS: none
  *   OUTPUTS: none
- *   RETURN VALUE: pid for the new process
+ *   RETURN VALUE: pid for the new process, -1 if out of pids or memory
 */
 int32_t allocate_process(void){
+    process_crtl_block_t* pcb_ptr;
+    pte_desc_t* user_pt;
     int32_t i;
-    for (i = 0; i < MAX_PROCESS_NUM; i++) {
-        if (process_map[i].status == UNOCCUPIED) {
-            process_map[i].status = OCCUPIED;
-            process_map[i].is_running = NOT_RUNNING;
-            process_map[i].pid = i;
-            process_map[i].terminal_id = cur_terminal_id;
-            return i;
-        }
+    int32_t pid = alloc_pid();
+    if (pid == FAILURE)
+        return FAILURE;
+    pcb_ptr = (process_crtl_block_t*)alloc_kernel_stack();
+    if (pcb_ptr == NULL)
+        return FAILURE;
+    user_pt = vm_create();
+    if (user_pt == NULL){
+        free_kernel_stack(pcb_ptr);
+        return FAILURE;
     }
-    /* no space for new process, return -1 */
-    return FAILURE;
+    pcb_ptr->page_dir = alloc_page_dir(user_pt);
+    if (pcb_ptr->page_dir == NULL){
+        vm_destroy(user_pt);
+        free_kernel_stack(pcb_ptr);
+        return FAILURE;
+    }
+    pcb_ptr->vidmap_pt = NULL;
+    pcb_ptr->user_pt = user_pt;
+    pcb_ptr->leader = pcb_ptr;
+    fd_table_init(&pcb_ptr->files);
+    pcb_ptr->fd_table = &pcb_ptr->files;
+    for (i = 0; i < SHM_PER_PROCESS; i++)
+        pcb_ptr->shm[i].id = FAILURE;
+    link_process(pcb_ptr, pid);
+    return pid;
+}
+
+/* allocate_thread
+ *   DESCRIPTION: allocate one more thread for a process, only the kernel
+ *                stack (pcb at the bottom) is new
+ *   INPUTS: leader_pcb - leader of the thread group to join
+ *   OUTPUTS: none
+ *   RETURN VALUE: pid (thread id) for the new thread, -1 if out of pids or memory
+*/
+int32_t allocate_thread(process_crtl_block_t* leader_pcb){
+    process_crtl_block_t* pcb_ptr;
+    int32_t pid = alloc_pid();
+    if (pid == FAILURE)
+        return FAILURE;
+    pcb_ptr = (process_crtl_block_t*)alloc_kernel_stack();
+    if (pcb_ptr == NULL)
+        return FAILURE;
+    pcb_ptr->page_dir = leader_pcb->page_dir;
+    pcb_ptr->user_pt = leader_pcb->user_pt;
+    pcb_ptr->vidmap_pt = NULL;
+    pcb_ptr->leader = leader_pcb;
+    pcb_ptr->fd_table = leader_pcb->fd_table;
+    link_process(pcb_ptr, pid);
+    return pid;
+}
+
+/* link_process
+ *   DESCRIPTION: common part of a new pcb, link it into the process list and
+ *                the pid hash
+ *   INPUTS: pcb_ptr - the new pcb
+ *           pid - its pid
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+*/
+static void link_process(process_crtl_block_t* pcb_ptr, int32_t pid){
+    pcb_ptr->pid = pid;
+    pcb_ptr->status = OCCUPIED;
+    pcb_ptr->is_running = NOT_RUNNING;
+    pcb_ptr->terminal_id = cur_terminal_id;
+    pcb_ptr->parent_waiting = 0;
+    pcb_ptr->terminal_root = 0;
+    pcb_ptr->join_waiter = NULL;
+    pcb_ptr->exit_status = 0;
+    pcb_ptr->futex_key = 0;
+    init_timer(&pcb_ptr->alarm_timer, alarm_fire, (uint32_t)pcb_ptr);
+    init_timer(&pcb_ptr->sleep_timer, NULL, 0);
+    pcb_ptr->heap_start = 0;
+    pcb_ptr->brk = 0;
+    pcb_ptr->next = process_list;
+    process_list = pcb_ptr;
+    pcb_ptr->hash_next = pid_hash[PID_HASH(pid)];
+    pid_hash[PID_HASH(pid)] = pcb_ptr;
 }
 
 /* free_process
- *   DESCRIPTION: free the process with given pid
+ *   DESCRIPTION: free the process with given pid, its kernel stack and user pages
  *   INPUTS: pid number
  *   OUTPUTS: none
  *   RETURN VALUE: none
+ *   SIDE EFFECTS: the pcb must not be touched after this call, and its page
+ *                 directory must not be the one in cr3
 */
 void free_process(int32_t pid){
-    process_map[pid].status = UNOCCUPIED;
-    process_map[pid].is_running = NOT_RUNNING;
-    process_map[pid].pid = NULL_PROCESS;
-    process_map[pid].terminal_id = DEFAULT_TERMINAL;
+    process_crtl_block_t* pcb_ptr = get_pcb(pid);
+    process_crtl_block_t** link;
+    if (pcb_ptr == NULL)
+        return;
+    for (link = &process_list; *link != NULL; link = &(*link)->next){
+        if (*link == pcb_ptr){
+            *link = pcb_ptr->next;
+            break;
+        }
+    }
+    for (link = &pid_hash[PID_HASH(pid)]; *link != NULL; link = &(*link)->hash_next){
+        if (*link == pcb_ptr){
+            *link = pcb_ptr->hash_next;
+            break;
+        }
+    }
+    // our children are orphans now, the scheduler reaps them when they exit
+    for (link = &process_list; *link != NULL; link = &(*link)->next){
+        if ((*link)->parent_pid == pid)
+            (*link)->parent_pid = NULL_PROCESS;
+    }
+    futex_cancel(pcb_ptr);
+    del_timer(&pcb_ptr->alarm_timer);
+    del_timer(&pcb_ptr->sleep_timer);
+    pcb_ptr->status = UNOCCUPIED;
+    pcb_ptr->is_running = NOT_RUNNING;
+    // threads only own their kernel stack
+    if (pcb_ptr->leader == pcb_ptr){
+        fd_table_destroy(pcb_ptr->fd_table);
+        shm_exit(pcb_ptr);
+        free_page_dir(pcb_ptr->page_dir);
+        if (pcb_ptr->vidmap_pt != NULL)
+            free_pages((uint32_t)pcb_ptr->vidmap_pt, FRAME_ORDER_4KB);
+        vm_destroy(pcb_ptr->user_pt);
+    }
+    free_kernel_stack(pcb_ptr);
+}
+
+/* exit_threads
+ *   DESCRIPTION: free every other thread of a process, running or exited
+ *   INPUTS: leader_pcb - leader of the thread group
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: must be called by the leader with interrupts off, the
+ *                 threads are dropped wherever they were scheduled out
+*/
+void exit_threads(process_crtl_block_t* leader_pcb){
+    process_crtl_block_t* pcb_ptr = process_list;
+    process_crtl_block_t* next_ptr;
+    while (pcb_ptr != NULL){
+        next_ptr = pcb_ptr->next;
+        if (pcb_ptr->leader == leader_pcb && pcb_ptr != leader_pcb)
+            free_process(pcb_ptr->pid);
+        pcb_ptr = next_ptr;
+    }
 }
 
 /* search_process
@@ -204,17 +504,48 @@ void free_process(int32_t pid){
  *   RETURN VALUE: pid of the running process in current terminal
 */
 int32_t search_process(int32_t terminal_id){
-    int32_t i;
-    for (i = 0; i < MAX_PROCESS_NUM; i++) {
+    process_crtl_block_t* pcb_ptr;
+    for (pcb_ptr = process_list; pcb_ptr != NULL; pcb_ptr = pcb_ptr->next) {
         /* find the current running process of the terminal */
-        if (process_map[i].status == OCCUPIED && process_map[i].is_running == RUNNING && process_map[i].terminal_id == terminal_id) {
-            return i;
+        if (pcb_ptr->status == OCCUPIED && pcb_ptr->is_running == RUNNING && pcb_ptr->terminal_id == terminal_id) {
+            return pcb_ptr->pid;
         }
     }
     /* terminal_id has no current running process, return -1 */
     return FAILURE;
 }
 
+/* search_foreground
+ *   DESCRIPTION: search the foreground process of a terminal, whether it
+ *                runs or sleeps: from the terminal's first shell down the
+ *                children each one waits for in execute. Background jobs
+ *                from spawn or fork are never on this chain.
+ *   INPUTS: terminal id
+ *   OUTPUTS: none
+ *   RETURN VALUE: pid of the foreground process, -1 if there is none
+*/
+int32_t search_foreground(int32_t terminal_id){
+    process_crtl_block_t* pcb_ptr;
+    process_crtl_block_t* child_ptr;
+    for (pcb_ptr = process_list; pcb_ptr != NULL; pcb_ptr = pcb_ptr->next) {
+        if (pcb_ptr->status == OCCUPIED && pcb_ptr->terminal_root && pcb_ptr->terminal_id == terminal_id)
+            break;
+    }
+    if (pcb_ptr == NULL)
+        return FAILURE;
+    /* a process sitting in execute is behind the child it waits for */
+    do {
+        for (child_ptr = process_list; child_ptr != NULL; child_ptr = child_ptr->next) {
+            if (child_ptr->status == OCCUPIED && child_ptr->leader == child_ptr
+                && child_ptr->parent_waiting && child_ptr->parent_pid == pcb_ptr->pid)
+                break;
+        }
+        if (child_ptr != NULL)
+            pcb_ptr = child_ptr;
+    } while (child_ptr != NULL);
+    return pcb_ptr->pid;
+}
+
 /* search_owner_terminal
  *   DESCRIPTION: the owner terminal (window) of current running process 
  *   INPUTS: request_pid
@@ -222,35 +553,93 @@ int32_t search_process(int32_t terminal_id){
  *   RETURN VALUE: the id of terminal that the input pid belongs to
 */
 int32_t search_owner_terminal(int32_t request_pid){
+    process_crtl_block_t* pcb_ptr;
     if(request_pid<0)
         return 0;
-    if (request_pid>=MAX_PROCESS_NUM)
-        return FAILURE;
-    if (process_map[request_pid].status == OCCUPIED){
-        return process_map[request_pid].terminal_id;
+    pcb_ptr = get_pcb(request_pid);
+    if (pcb_ptr != NULL && pcb_ptr->status != UNOCCUPIED){
+        return pcb_ptr->terminal_id;
     }
     return FAILURE;
 }
 
-static int32_t round_robin_next_pid(int32_t cur_pid_owner_terminal){
-    int32_t active_list[2] = {search_process((cur_pid_owner_terminal+1)%TERMINAL_NUM),
-                              search_process((cur_pid_owner_terminal+2)%TERMINAL_NUM)};
-    int32_t i, next_pid;
-    next_pid = cur_pid;
-    for (i=0; i<2; i++){
-        if(active_list[i]!=FAILURE){
-            next_pid = active_list[i];
-            break;
-        }
+/* round_robin_next
+ *   DESCRIPTION: pick the next runnable process after the current one
+ *   INPUTS: cur_pcb_ptr - current process, may be NULL
+ *   OUTPUTS: none
+ *   RETURN VALUE: the next running pcb, the current one if it is the only
+ *                 runnable process, NULL if nothing can run
+*/
+static process_crtl_block_t* round_robin_next(process_crtl_block_t* cur_pcb_ptr){
+    process_crtl_block_t* pcb_ptr = (cur_pcb_ptr != NULL) ? cur_pcb_ptr->next : process_list;
+    // walk to the end of the list, then wrap around to the current one
+    for (;; pcb_ptr = pcb_ptr->next){
+        if (pcb_ptr == NULL)
+            pcb_ptr = process_list;
+        if (pcb_ptr == NULL)
+            return NULL;
+        if (pcb_ptr->status == OCCUPIED && pcb_ptr->is_running == RUNNING)
+            return pcb_ptr;
+        if (pcb_ptr == cur_pcb_ptr)
+            return NULL;
+    }
+}
+
+/* reap_zombies
+ *   DESCRIPTION: free the processes that exited with no parent left to
+ *                collect them in waitpid
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: the current process is skipped, we may be on its stack
+*/
+static void reap_zombies(void){
+    process_crtl_block_t* pcb_ptr = process_list;
+    process_crtl_block_t* next_ptr;
+    while (pcb_ptr != NULL){
+        next_ptr = pcb_ptr->next;
+        // exited threads stay until thread_join or their process exits,
+        // exited children until their parent calls waitpid or exits
+        if (pcb_ptr->status == ZOMBIE && pcb_ptr->pid != cur_pid && pcb_ptr->leader == pcb_ptr
+            && pcb_ptr->parent_pid == NULL_PROCESS)
+            free_process(pcb_ptr->pid);
+        pcb_ptr = next_ptr;
     }
-    return next_pid;
 }
 
+/* switch_to_process
+ *   DESCRIPTION: load the address space, kernel stack and terminal of another
+ *                process and resume it where it last stopped
+ *   INPUTS: next_pcb_ptr - process to run
+ *   OUTPUTS: none
+ *   RETURN VALUE: never returns
+*/
+static void switch_to_process(process_crtl_block_t* next_pcb_ptr){
+    int32_t next_terminal = next_pcb_ptr->terminal_id;
+    // change paging, one cr3 load
+    set_process_pd(next_pcb_ptr->pid);
+    // change tss
+    tss.esp0 = next_pcb_ptr->tss_esp0;
+
+    // maintain next terminal's screen pos
+    set_screen_pos(terminal_list[next_terminal].cursor_x, terminal_list[next_terminal].cursor_y);
+    cur_pid = next_pcb_ptr->pid;
+    update_multi_process_vidmem(next_terminal);
+    active_terminal = next_terminal;
+    jump_to_next_process(next_pcb_ptr->esp, next_pcb_ptr->ebp);
+}
+
+/* process_switch
+ *   DESCRIPTION: scheduler entry from the pit, give the cpu to the next
+ *                runnable process
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none, returns when this process is scheduled again
+*/
 void process_switch(){
-    int32_t cur_pid_owner_terminal = search_owner_terminal(cur_pid);
-    int32_t next_pid = round_robin_next_pid(cur_pid_owner_terminal);
-    // save the esp and ebp every time we go in 
     process_crtl_block_t * cur_pcb_ptr = get_pcb(cur_pid);
+    process_crtl_block_t * next_pcb_ptr;
+    // save the esp and ebp every time we go in 
     uint32_t cur_esp = 0;
     uint32_t cur_ebp = 0;
     asm volatile(
@@ -267,31 +656,52 @@ void process_switch(){
     // keep track of screen pos for current pid's terminal
     int32_t cur_screen_x, cur_screen_y;
     get_screen_pos(&cur_screen_x, &cur_screen_y);
-    terminal_list[cur_pid_owner_terminal].cursor_x = cur_screen_x;
-    terminal_list[cur_pid_owner_terminal].cursor_y = cur_screen_y;
+    terminal_list[cur_pcb_ptr->terminal_id].cursor_x = cur_screen_x;
+    terminal_list[cur_pcb_ptr->terminal_id].cursor_y = cur_screen_y;
+
+    reap_zombies();
+    next_pcb_ptr = round_robin_next(cur_pcb_ptr);
     // same process? do nothing then
-    if (next_pid==cur_pid)
+    if (next_pcb_ptr == NULL || next_pcb_ptr == cur_pcb_ptr)
         return;
-    process_crtl_block_t * next_pcb_ptr = get_pcb(next_pid);
-    // TODO: context switch to next process
-    // switch to another one
-    uint32_t next_esp, next_ebp;
-    next_esp = next_pcb_ptr->esp;
-    next_ebp = next_pcb_ptr->ebp;
-    // change paging
-    set_user_pt(next_pid);
-    // change tss
-    tss.esp0 = next_pcb_ptr->tss_esp0;
+    switch_to_process(next_pcb_ptr);
+}
 
-    // maintain next terminal's screen pos
-    int32_t next_terminal, new_screen_x, new_screen_y;
-    next_terminal = search_owner_terminal(next_pid);
-    new_screen_x = terminal_list[next_terminal].cursor_x;
-    new_screen_y = terminal_list[next_terminal].cursor_y;
-    set_screen_pos(new_screen_x, new_screen_y);
-    cur_pid = next_pid;
-    //set_multi_process_vidmem(0,NULL);
-    update_multi_process_vidmem(search_owner_terminal(cur_pid));
-    active_terminal = search_owner_terminal(cur_pid);
-    jump_to_next_process(next_esp, next_ebp);
+/* process_wait
+ *   DESCRIPTION: give up the cpu once the caller marked itself as not
+ *                running, e.g. to sleep until someone wakes it
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none, the caller rechecks what it waits for
+ *   SIDE EFFECTS: must be called with interrupts off, halts the cpu until
+ *                 the next interrupt if nothing can run, with the PIT
+ *                 tick stopped up to the next kernel timer
+*/
+void process_wait(){
+    process_crtl_block_t * cur_pcb_ptr = get_pcb(cur_pid);
+    process_switch();
+    // bottom halves raised by interrupts that ended in a switch to us
+    do_softirq();
+    if (cur_pcb_ptr->is_running != RUNNING){
+        // no tick while halted unless a timer needs one
+        pit_idle_enter();
+        sti();
+        asm volatile("hlt");
+        cli();
+        pit_idle_exit();
+        // the ticks idle skipped
+        do_softirq();
+    }
+}
+
+/* process_exit_switch
+ *   DESCRIPTION: leave a process that will never run again, e.g. an exited
+ *                fork child waiting to be reaped
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: never returns
+*/
+void process_exit_switch(){
+    while (1)
+        process_wait();
 }
@@ -3,6 +3,9 @@
 #include "process_crtl.h"
 #include "do_syscall.h"
 #include "idt.h"
+#include "ktimer.h"
+#include "asm_linkage.h"
+#include "memory/vm.h"
 
 extern void signal_set_up_stack_helper(signal_handler handler, int32_t signum, sig_regs *hw_context_addr);
 
@@ -18,9 +21,15 @@ int32_t signal_interrupt_default_handler();
 int32_t signal_alarm_default_handler();
 int32_t signal_user1_default_handler();
 int32_t set_frame(sig_regs* r, int32_t signum, process_crtl_block_t* pcb, signal_handler sig_handler);
-// default signal handler list, convenient to get
+// default signal handler list, convenient to get. NULL means ignore.
 signal_handler default_handlers[NUM_SIGNAL] = {signal_div_zero_default_handler, signal_segfault_default_handler, signal_interrupt_default_handler, signal_alarm_default_handler, signal_user1_default_handler};
 
+// asm_linkage.S finds the signal sets of the current pcb through these
+typedef char pcb_sig_pending_check[__builtin_offsetof(process_crtl_block_t, sig_pending) == PCB_SIG_PENDING ? 1 : -1];
+typedef char pcb_sig_blocked_check[__builtin_offsetof(process_crtl_block_t, sig_blocked) == PCB_SIG_BLOCKED ? 1 : -1];
+typedef char frame_cs_check[__builtin_offsetof(sig_regs, cs) == FRAME_CS ? 1 : -1];
+typedef char kstack_mask_check[KSTACK_MASK == ~(KSTACK_SIZE - 1) ? 1 : -1];
+
 /*
  * sig_init
  *   DESCRIPTION: initialize the signal part in the pcb 
@@ -34,43 +43,52 @@ void sig_init(process_crtl_block_t* pcb){
     for(i = 0; i < NUM_SIGNAL; i++){
         pcb->sig[i].signum = i;
         pcb->sig[i].sig_handler = default_handlers[i];
-        pcb->sig[i].mask = UNMASK;
-        pcb->sig[i].pending = NOPENDING;
     }
+    pcb->sig_pending = 0;
+    pcb->sig_blocked = 0;
+    pcb->sig_saved_blocked = 0;
 }
 
 /*
  * sig_handler_func
- *   DESCRIPTION: handlers the signal
+ *   DESCRIPTION: handlers the signal. The trap return path only calls us
+ *                when a signal is pending and not blocked.
  *   INPUTS: r    - the H/W content from the system call
  *   OUTPUTS: None
  *   RETURN VALUE: None
+ *   SIDE EFFECTS: default actions run right away, the first signal with a
+ *                 user handler gets a frame and every signal is blocked
+ *                 until its sigreturn. On a frame that goes back to the
+ *                 kernel only a fault is handled, with its default action.
  */
 asmlinkage void sig_handler_func( sig_regs r){
     process_crtl_block_t *pcb  = get_cur_pcb();
-    int32_t i, j;
-    // iterate the five signal struct
-    for(i = 0; i < NUM_SIGNAL; i ++){
-        signal_struct *sig = &pcb->sig[i];
-        // if there is no pending  or the signal is masked
-        if((sig->pending == NOPENDING) || (sig->mask == MASK)){
-            continue;
-        }
-        else{
-            sig->pending = NOPENDING; 
-            // set all the signal to masked
-            for(j = 0; j < NUM_SIGNAL; j++){
-                pcb->sig[j].mask = MASK;
-            }
-            // if the handler is the default handler
-            if((sig->sig_handler == default_handlers[i]) || (sig->sig_handler == NULL)){
+    signal_handler handler;
+    uint32_t ready;
+    int32_t i;
+    if (pcb == NULL)
+        return;
+    ready = pcb->sig_pending & ~pcb->sig_blocked;
+    // a kernel frame has no user stack for a handler frame, and the kernel
+    // can't be halted under a driver, the rest waits for user mode
+    if ((r.cs & 3) != 3)
+        ready &= SIG_UNBLOCKABLE;
+    // lowest signal first
+    while (ready != 0){
+        asm volatile ("bsfl %1, %0" : "=r"(i) : "rm"(ready) : "cc");
+        ready &= ~SIG_BIT(i);
+        pcb->sig_pending &= ~SIG_BIT(i);
+        handler = pcb->sig[i].sig_handler;
+        // if the handler is the default handler
+        if((handler == default_handlers[i]) || (handler == NULL) || (r.cs & 3) != 3){
+            if (default_handlers[i] != NULL)
                 default_handlers[i]();
-            }
-            else{
-                // printf("This is not the default signal handler");
-                set_frame(&r, i, pcb, sig->sig_handler);
-            }
+            continue;
         }
+        pcb->sig_saved_blocked = pcb->sig_blocked;
+        pcb->sig_blocked = SIG_ALL & ~SIG_UNBLOCKABLE;
+        set_frame(&r, i, pcb, handler);
+        return;
     }
 }
 
@@ -130,16 +148,91 @@ int32_t set_frame(sig_regs* r, int32_t signum, process_crtl_block_t* pcb, signal
  */
 void signal_raise(int32_t signum){
     process_crtl_block_t *pcb;
-    // if ctrl+C, we need to halt the program we saw
+    // if ctrl+C, we need to halt the program we saw, also when it sleeps
     if(signum ==2){
-        int32_t pid = search_process(cur_terminal_id);
+        int32_t pid = search_foreground(cur_terminal_id);
         pcb = get_pcb(pid);
     }
     else{
         pcb = get_cur_pcb();
     }
-    signal_struct *sig = &pcb->sig[signum];
-    sig->pending = PENDING;
+    // nothing runs on the terminal
+    if (pcb == NULL)
+        return;
+    signal_send(pcb, signum);
+}
+
+/*
+ * signal_send
+ *   DESCRIPTION: mark a signal pending on a given process, it is handled
+ *                when that process next returns to user mode
+ *   INPUTS: pcb - process to signal
+ *           signum - species of the signal
+ *   OUTPUTS: None
+ *   RETURN VALUE: None
+ */
+void signal_send(process_crtl_block_t* pcb, int32_t signum){
+    uint32_t flags;
+    if (pcb == NULL)
+        return;
+    cli_and_save(flags);
+    pcb->sig_pending |= SIG_BIT(signum);
+    // a sleeper in futex_sleep gives up the sleep to take it
+    if (pcb->futex_key != 0 && signal_interrupts_sleep(pcb))
+        pcb->is_running = RUNNING;
+    restore_flags(flags);
+}
+
+/*
+ * signal_interrupts_sleep
+ *   DESCRIPTION: check whether a pending signal has to end a sleep in the
+ *                kernel: one that is not blocked and has a user handler or
+ *                a default that halts. Defaults that do nothing, like the
+ *                periodic ALARM, let the sleep go on.
+ *   INPUTS: pcb - sleeping process
+ *   OUTPUTS: None
+ *   RETURN VALUE: 1 if it does, 0 otherwise
+ */
+int32_t signal_interrupts_sleep(process_crtl_block_t* pcb){
+    uint32_t ready = pcb->sig_pending & ~pcb->sig_blocked;
+    int32_t i;
+    while (ready != 0){
+        asm volatile ("bsfl %1, %0" : "=r"(i) : "rm"(ready) : "cc");
+        ready &= ~SIG_BIT(i);
+        if (pcb->sig[i].sig_handler == NULL)
+            continue;
+        if (pcb->sig[i].sig_handler != default_handlers[i] || (SIG_BIT(i) & SIG_DEFAULT_HALTS))
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ * alarm_fire
+ *   DESCRIPTION: timer callback of pcb->alarm_timer, raise ALARM and arm
+ *                the next period if the alarm repeats
+ *   INPUTS: data - the pcb
+ *   OUTPUTS: None
+ *   RETURN VALUE: None
+ */
+void alarm_fire(uint32_t data){
+    process_crtl_block_t* pcb = (process_crtl_block_t*)data;
+    signal_send(pcb, ALARM);
+    // step from the old expiry so the period does not drift
+    if (pcb->alarm_period != 0)
+        add_timer(&pcb->alarm_timer, pcb->alarm_timer.expires + pcb->alarm_period);
+}
+
+/*
+ * alarm_start
+ *   DESCRIPTION: arm the periodic ALARM a new process or thread starts with
+ *   INPUTS: pcb - the new pcb
+ *   OUTPUTS: None
+ *   RETURN VALUE: None
+ */
+void alarm_start(process_crtl_block_t* pcb){
+    pcb->alarm_period = ms_to_ticks(ALARM_PERIOD_MS);
+    add_timer(&pcb->alarm_timer, timer_ticks + pcb->alarm_period);
 }
 
 
@@ -169,6 +262,42 @@ int32_t set_handler (int32_t signum, void* handler_address)
     return SUCCESS;
 }
 
+/*
+ * sigprocmask
+ *   DESCRIPTION: read and change the set of blocked signals of the calling
+ *                thread. A blocked signal stays pending until unblocked.
+ *   INPUTS: how - SIG_BLOCK adds set, SIG_UNBLOCK removes it, SIG_SETMASK
+ *                 replaces the blocked set with it
+ *           set - user pointer to the signal bits, NULL only reads
+ *           oldset - user pointer for the old set, may be NULL
+ *   OUTPUTS: *oldset - blocked set before the call
+ *   RETURN VALUE: 0 for success and -1 for a bad how or pointer
+ *   SIDE EFFECTS: DIV_ZERO and SEGFAULT can not be blocked
+ */
+int32_t sigprocmask(int32_t how, const uint32_t* set, uint32_t* oldset)
+{
+    process_crtl_block_t* pcb = get_cur_pcb();
+    uint32_t blocked;
+    if (pcb == NULL)
+        return FAILURE;
+    if ((set != NULL && ((uint32_t)set < USER_MEMORY || (uint32_t)set > VIRTUAL_MEMORY_END_ADDRESS - sizeof(uint32_t)))
+        || (oldset != NULL && vm_user_writable(pcb, (uint32_t)oldset, sizeof(uint32_t)) == FAILURE))
+        return FAILURE;
+    blocked = pcb->sig_blocked;
+    if (set != NULL){
+        switch (how){
+            case SIG_BLOCK: blocked |= *set; break;
+            case SIG_UNBLOCK: blocked &= ~*set; break;
+            case SIG_SETMASK: blocked = *set; break;
+            default: return FAILURE;
+        }
+    }
+    if (oldset != NULL)
+        *oldset = pcb->sig_blocked;
+    pcb->sig_blocked = blocked & ~SIG_UNBLOCKABLE;
+    return SUCCESS;
+}
+
 /*
  * sigreturn_func
  *   DESCRIPTION: sigreturn part
@@ -179,10 +308,8 @@ int32_t set_handler (int32_t signum, void* handler_address)
 void sigreturn_fuc(sig_regs r){
     r = *(sig_regs*)(r.useresp+4);
     process_crtl_block_t* pcb = get_cur_pcb();
-    uint32_t i;
-    for(i = 0; i < NUM_SIGNAL; i++){
-        pcb->sig[i].mask = 0;
-    }
+    // back to the blocked set from before the handler
+    pcb->sig_blocked = pcb->sig_saved_blocked;
     asm volatile(
         "movl %0, %%eax"
         :
@@ -6,7 +6,6 @@
 #include "do_syscall.h"
 
 
-#define NUM_SIGNAL 5
 #define SIGRETURN_VAL 10
 #define RET_LENGTH 8
 
@@ -15,12 +14,29 @@
 #define INTERRUPT 2
 #define ALARM 3
 #define USER1 4
+#define CHILD 5
+/* 6 to NUM_SIGNAL - 1 have no meaning of their own, ignored by default */
 
-#define UNMASK 0
-#define MASK 1
-#define NOPENDING 0
-#define PENDING 1
+#define SIG_BIT(signum)     (1U << (signum))
+#define SIG_ALL             0xFFFFFFFF
+/* faults would only repeat while blocked */
+#define SIG_UNBLOCKABLE     (SIG_BIT(DIV_ZERO) | SIG_BIT(SEGFAULT))
+/* the default action of these halts the process, the other defaults do
+   nothing */
+#define SIG_DEFAULT_HALTS   (SIG_UNBLOCKABLE | SIG_BIT(INTERRUPT))
+
+/* sigprocmask how */
+#define SIG_BLOCK   0
+#define SIG_UNBLOCK 1
+#define SIG_SETMASK 2
+
+/* every process gets an ALARM this often until it calls alarm() */
+#define ALARM_PERIOD_MS 10000
 
 void sig_init(process_crtl_block_t* pcb);
 void signal_raise(int32_t signum);
+void signal_send(process_crtl_block_t* pcb, int32_t signum);
+int32_t signal_interrupts_sleep(process_crtl_block_t* pcb);
+void alarm_fire(uint32_t data);
+void alarm_start(process_crtl_block_t* pcb);
 #endif
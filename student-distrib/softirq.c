@@ -0,0 +1,202 @@
+#include "softirq.h"
+#include "lib.h"
+
+static work_t* pop_work(void);
+static void run_work(void);
+
+static volatile uint32_t pending_mask = 0;
+// set while do_softirq runs the handlers, an interrupt on top of them
+// leaves what it raised to the running loop
+static volatile int32_t running = 0;
+static void (*softirq_vec[NUM_SOFTIRQ])(void) = {
+    [SOFTIRQ_WORK] = run_work
+};
+
+// scheduled work items, oldest first
+static work_t* work_head = NULL;
+static work_t** work_tail = &work_head;
+static int32_t work_count = 0;
+
+/*
+ * open_softirq
+ *   DESCRIPTION: install the handler of a softirq
+ *   INPUTS: nr - softirq number, SOFTIRQ_*
+ *           fn - handler, runs with interrupts enabled
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void open_softirq(int32_t nr, void (*fn)(void)){
+    softirq_vec[nr] = fn;
+}
+
+/*
+ * raise_softirq
+ *   DESCRIPTION: mark a softirq to run on the next interrupt exit
+ *   INPUTS: nr - softirq number, SOFTIRQ_*
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void raise_softirq(int32_t nr){
+    uint32_t flags;
+    cli_and_save(flags);
+    pending_mask |= 1U << nr;
+    restore_flags(flags);
+}
+
+/*
+ * softirq_pending
+ *   DESCRIPTION: check whether any softirq waits to run
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if one is raised, 0 otherwise
+ */
+int32_t softirq_pending(void){
+    return pending_mask != 0;
+}
+
+/*
+ * in_softirq
+ *   DESCRIPTION: check whether we run inside do_softirq, or in an interrupt
+ *                on top of it
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 inside, 0 otherwise
+ */
+int32_t in_softirq(void){
+    return running;
+}
+
+/*
+ * softirq_leave
+ *   DESCRIPTION: give up the running softirq for good, for a handler that
+ *                leaves its stack and never comes back, e.g. to execute a
+ *                new shell
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: what is still raised runs on the next interrupt exit
+ */
+void softirq_leave(void){
+    uint32_t flags;
+    cli_and_save(flags);
+    running = 0;
+    // work items behind the one that leaves
+    if (work_head != NULL)
+        pending_mask |= 1U << SOFTIRQ_WORK;
+    restore_flags(flags);
+}
+
+/*
+ * do_softirq
+ *   DESCRIPTION: run every raised softirq, also the ones raised while they
+ *                run, up to SOFTIRQ_MAX_RESTART rounds
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: called on interrupt exit and before idle, enables
+ *                 interrupts around the handlers and returns with the
+ *                 caller's flags
+ */
+void do_softirq(void){
+    uint32_t flags, pending;
+    int32_t nr, restart = SOFTIRQ_MAX_RESTART;
+    cli_and_save(flags);
+    if (running || pending_mask == 0){
+        restore_flags(flags);
+        return;
+    }
+    running = 1;
+    do {
+        pending = pending_mask;
+        pending_mask = 0;
+        sti();
+        for (nr = 0; pending != 0; nr++, pending >>= 1){
+            if ((pending & 1) && softirq_vec[nr] != NULL)
+                softirq_vec[nr]();
+        }
+        cli();
+    } while (pending_mask != 0 && --restart > 0);
+    running = 0;
+    restore_flags(flags);
+}
+
+/*
+ * init_work
+ *   DESCRIPTION: set up a work item before its first schedule_work
+ *   INPUTS: work - work item to set up
+ *           fn - callback, runs from SOFTIRQ_WORK
+ *           data - argument for fn
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void init_work(work_t* work, void (*fn)(uint32_t), uint32_t data){
+    work->next = NULL;
+    work->fn = fn;
+    work->data = data;
+    work->queued = 0;
+}
+
+/*
+ * schedule_work
+ *   DESCRIPTION: have fn of a work item called once from SOFTIRQ_WORK
+ *   INPUTS: work - work item from init_work
+ *   OUTPUTS: none
+ *   RETURN VALUE: 1 if queued, 0 if it was still queued from before
+ */
+int32_t schedule_work(work_t* work){
+    uint32_t flags;
+    cli_and_save(flags);
+    if (work->queued){
+        restore_flags(flags);
+        return 0;
+    }
+    work->queued = 1;
+    work->next = NULL;
+    *work_tail = work;
+    work_tail = &work->next;
+    work_count++;
+    pending_mask |= 1U << SOFTIRQ_WORK;
+    restore_flags(flags);
+    return 1;
+}
+
+/*
+ * pop_work
+ *   DESCRIPTION: take the oldest scheduled work item off the queue
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the item, NULL if none is queued
+ */
+static work_t* pop_work(void){
+    work_t* work;
+    uint32_t flags;
+    cli_and_save(flags);
+    work = work_head;
+    if (work != NULL){
+        work_head = work->next;
+        if (work_head == NULL)
+            work_tail = &work_head;
+        work_count--;
+        // may be scheduled again from fn
+        work->queued = 0;
+    }
+    restore_flags(flags);
+    return work;
+}
+
+/*
+ * run_work
+ *   DESCRIPTION: SOFTIRQ_WORK handler, call the work items that were
+ *                scheduled when it started, in order. Items scheduled
+ *                meanwhile wait for the next round, and one that never
+ *                returns leaves the rest on the queue.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void run_work(void){
+    work_t* work;
+    int32_t count = work_count;
+    while (count-- > 0 && (work = pop_work()) != NULL)
+        work->fn(work->data);
+}
@@ -0,0 +1,40 @@
+#ifndef _SOFTIRQ_H
+#define _SOFTIRQ_H
+
+#include "types.h"
+
+/* deferred interrupt work. A top half only takes the event off the device,
+ * queues it and raises its softirq; the softirqs run on the way out of the
+ * interrupt with interrupts enabled, one at a time and lowest number first.
+ * Nothing is scheduled away while one runs. */
+#define SOFTIRQ_TIMER       0
+#define SOFTIRQ_KEYBOARD    1
+#define SOFTIRQ_MOUSE       2
+// work items, last so a switch that never comes back runs after the rest
+#define SOFTIRQ_WORK        3
+#define NUM_SOFTIRQ         4
+
+// rounds of newly raised softirqs one interrupt exit handles, the rest
+// waits for the next interrupt
+#define SOFTIRQ_MAX_RESTART 10
+
+typedef struct work {
+    struct work* next;
+    // called from SOFTIRQ_WORK with data, interrupts enabled
+    void (*fn)(uint32_t data);
+    uint32_t data;
+    // 1 from schedule_work until fn is called
+    int32_t queued;
+} work_t;
+
+void open_softirq(int32_t nr, void (*fn)(void));
+void raise_softirq(int32_t nr);
+int32_t softirq_pending(void);
+int32_t in_softirq(void);
+void softirq_leave(void);
+void do_softirq(void);
+
+void init_work(work_t* work, void (*fn)(uint32_t), uint32_t data);
+int32_t schedule_work(work_t* work);
+
+#endif /* _SOFTIRQ_H */
@@ -5,10 +5,14 @@
 #include "process_crtl.h"
 #include "terminal.h"
 #include "timer.h"
+#include "ktimer.h"
 #include "data/terminal_icon.h"
 #include "data/minimize.h"
 
 char previous_time_list[TIMER_BUF_LEN] = {0};
+static ktimer_t clock_timer;
+
+static void clock_tick_for_sb(uint32_t data);
 // for terminal switch
 void swtich_terminal_for_sb()
 {
@@ -155,3 +159,17 @@ void draw_terminal_icon(void){
         }
     }
 }
+
+// redraw the clock and come back in STATUS_BAR_CLOCK_MS
+static void clock_tick_for_sb(uint32_t data)
+{
+    clock_update_for_sb();
+    add_timer(&clock_timer, clock_timer.expires + ms_to_ticks(STATUS_BAR_CLOCK_MS));
+}
+
+// keep the status bar clock running off the timer wheel
+void clock_start_for_sb()
+{
+    init_timer(&clock_timer, clock_tick_for_sb, 0);
+    add_timer(&clock_timer, timer_ticks + ms_to_ticks(STATUS_BAR_CLOCK_MS));
+}
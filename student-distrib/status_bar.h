@@ -10,6 +10,8 @@
 #define STATUS_BAR_TIMER_END   80
 
 #define TIMER_BUF_LEN          20
+/* how often the clock on the status bar is redrawn */
+#define STATUS_BAR_CLOCK_MS    500
 
 #define STATUS_BAR_HEIGHT       25
 #define FOUR_OFFSET             4
@@ -27,6 +29,7 @@
 void swtich_terminal_for_sb();
 void message_update_for_sb(char* message, uint32_t len, uint8_t param);
 void clock_update_for_sb();
+void clock_start_for_sb();
 
 // updated version: draw terminal icon
 #define TERMINAL_ICON_BLOCK_DIM     16
@@ -10,6 +10,8 @@
 #include "data/desktop.h"
 #include "mouse_graphic.h"
 #include "devices/mouse.h"
+#include "futex.h"
+#include "softirq.h"
 
 terminal_t terminal_list[TERMINAL_NUM];
 int32_t just_switch = 0;
@@ -32,16 +34,27 @@ int32_t terminal_open(){
  *   DESCRIPTION: read from the keyboard buffer after pressing enter
  *   INPUTS: none 
  *   OUTPUTS: none
- *   RETURN VALUE: number of bytes copied
+ *   RETURN VALUE: number of bytes copied, -1 if a signal ended the wait
  */
 int32_t terminal_read(int32_t fd, uint8_t *buf, int32_t nbytes){
     if (buf==NULL)
         return -1;
     int i=0;
+    uint32_t flags;
+    int32_t owner = search_owner_terminal(cur_pid);
 
-    while (!get_enter_press() || 
-           (cur_terminal_id!=search_owner_terminal(cur_pid))){}
+    // sleep until enter is pressed on our own terminal, the keyboard
+    // handler wakes us
+    cli_and_save(flags);
+    while (!get_enter_press() || cur_terminal_id!=owner){
+        if (futex_sleep((uint32_t)&terminal_list[owner].enter_pressed_flag) != SUCCESS){
+            // e.g. Ctrl-C, the signal is taken on the way out
+            restore_flags(flags);
+            return -1;
+        }
+    }
     clear_enter_press();
+    restore_flags(flags);
     // enter pressed
     while (keyboard_buffer[i] != '\n' && i<nbytes){
         buf[i] = keyboard_buffer[i];
@@ -152,9 +165,14 @@ file_ops_table_t get_stdout_ops(){
     return op;
 }
 
+// one pending switch, a later request replaces the terminal it goes to
+static work_t switch_work;
+static void terminal_switch_work(uint32_t new_terminal);
+
 void multi_terminal_init()
 {
     int i=0;
+    init_work(&switch_work, terminal_switch_work, 0);
     for(i=0;i<TERMINAL_NUM;i++)
     {
         terminal_list[i].cursor_x = 0;
@@ -179,6 +197,36 @@ void multi_terminal_init()
 
 }
 
+/*
+ * terminal_switch_work
+ *   DESCRIPTION: work item of terminal_switch_later
+ *   INPUTS: new_terminal - terminal to show
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void terminal_switch_work(uint32_t new_terminal)
+{
+    terminal_switch((int)new_terminal);
+}
+
+/*
+ * terminal_switch_later
+ *   DESCRIPTION: switch terminals from a work item, for the keyboard and
+ *                mouse softirqs. The switch copies whole video pages and may
+ *                execute a shell that never returns to the caller.
+ *   INPUTS: new_terminal - terminal to show
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void terminal_switch_later(int new_terminal)
+{
+    uint32_t flags;
+    cli_and_save(flags);
+    switch_work.data = new_terminal;
+    schedule_work(&switch_work);
+    restore_flags(flags);
+}
+
 int32_t terminal_switch(int new_terminal)
 {
     // current = new, we do not switch
@@ -229,12 +277,15 @@ int32_t terminal_switch(int new_terminal)
     // control_block_update(PARM_1_ON_BLACK, PARM_2_ON_BLACK, PARM_3_ON_BLACK);
     draw_terminal_icon();
 
-    // should check wheter running == visable, cannot directly change video memory pointer.
-    //update_multi_process_vidmem(search_owner_terminal(cur_pid));
+    // the running process may belong to another terminal than the one on
+    // screen now, point its video memory back at the right place
+    update_multi_process_vidmem(search_owner_terminal(cur_pid));
 
     graphic_mouse_clear_force(mouse_x_pos, mouse_y_pos);
     if (terminal_list[new_terminal].shell_opened == 0){
         set_screen_pos(new_screen_x, new_screen_y);
+        // the new shell does not come back to the work item
+        softirq_leave();
         execute("shell");
     }
     //sti();
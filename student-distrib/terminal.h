@@ -34,6 +34,7 @@ typedef struct terminal_t
 void multi_terminal_init();
 
 int32_t terminal_switch(int new_terminal);
+void terminal_switch_later(int new_terminal);
 
 extern terminal_t terminal_list[TERMINAL_NUM];
 
@@ -9,6 +9,19 @@
 #include "do_syscall.h"
 #include "types.h"
 #include "process_crtl.h"
+#include "memory/frame.h"
+#include "memory/slab.h"
+#include "memory/vm.h"
+#include "memory/image.h"
+#include "elf.h"
+#include "pipe.h"
+#include "filesystem/file.h"
+#include "timer.h"
+#include "devices/tsc.h"
+#include "ktimer.h"
+#include "devices/pit.h"
+#include "signal.h"
+#include "softirq.h"
 
 #define PASS 1
 #define FAIL 0
@@ -846,13 +859,17 @@ int rtc_cp2_testing(){
 	int test_fre[RTC_TEST_LEN] = {2, 4, 8, 16, 32, 64, 128, 256, 512, 1024};
 	int i;
 	int j;
+	int32_t rtc = rtc_open();
+	if (rtc == -1)
+		return FAIL;
 	for(i = 0; i<= 9; i++){
-		rtc_write(test_fre[i]);
+		rtc_write((rtc_file_t*)rtc, test_fre[i]);
 		for(j = test_fre[i]-1; j>=0; j--){
-			rtc_read();
+			rtc_read((rtc_file_t*)rtc);
 			printf("%d", test_fre[i]);
 		}
 	}
+	rtc_close((rtc_file_t*)rtc);
     return PASS;
 }
 
@@ -886,8 +903,8 @@ void scrolling_testing()
  */
 void test_file_operation1(){
     // first things about rtc
-    cur_pid = 0;
-    init_fda(0);
+    cur_pid = allocate_process();
+    create_PCB(cur_pid, (int8_t*)"", PROCESS_NO_FORK);
     int32_t fd;
     int32_t cnt = 10;
     uint8_t filename[] = "rtc";
@@ -917,8 +934,8 @@ void test_file_operation1(){
  */
 void test_file_operation2(){
     // first things about rtc
-    cur_pid = 0;
-    init_fda(0);
+    cur_pid = allocate_process();
+    create_PCB(cur_pid, (int8_t*)"", PROCESS_NO_FORK);
     int32_t fd_rtc, fd_fish, read_size, i;
     uint8_t buf[30];
     int32_t cnt = 20;
@@ -957,6 +974,712 @@ void test_file_operation2(){
 }
 
 
+/* Memory management tests */
+
+/* frame_alloc_test
+ *
+ * Asserts that the buddy allocator hands out aligned, distinct blocks and
+ * gets every frame back on free
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: alloc_pages, free_pages, frame_free_count
+ * Files: memory/frame.c/h
+ */
+int frame_alloc_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t free_before = frame_free_count();
+	uint32_t page_a = alloc_pages(FRAME_ORDER_4KB);
+	uint32_t page_b = alloc_pages(FRAME_ORDER_4KB);
+	uint32_t stack = alloc_pages(FRAME_ORDER_8KB);
+	uint32_t big = alloc_pages(FRAME_ORDER_4MB);
+	if (page_a == 0 || page_b == 0 || stack == 0 || big == 0 || page_a == page_b)
+		result = FAIL;
+	if ((page_a & (FRAME_SIZE - 1)) || (stack & (KSTACK_SIZE - 1)) || (big & (FRAME_SIZE_4MB - 1)))
+		result = FAIL;
+	if (frame_free_count() != free_before - 2 - 2 - (1 << FRAME_ORDER_4MB))
+		result = FAIL;
+	free_pages(page_a, FRAME_ORDER_4KB);
+	free_pages(page_b, FRAME_ORDER_4KB);
+	free_pages(stack, FRAME_ORDER_8KB);
+	free_pages(big, FRAME_ORDER_4MB);
+	if (frame_free_count() != free_before)
+		result = FAIL;
+	return result;
+}
+
+/* frame_share_test
+ *
+ * Asserts that a shared frame (copy-on-write page) is only freed when its
+ * last mapping drops it
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: frame_get, frame_put, frame_refcount
+ * Files: memory/frame.c/h
+ */
+int frame_share_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t free_before = frame_free_count();
+	uint32_t page = alloc_pages(FRAME_ORDER_4KB);
+	if (page == 0 || frame_refcount(page) != 1)
+		return FAIL;
+	frame_get(page);
+	if (frame_refcount(page) != 2)
+		result = FAIL;
+	frame_put(page);
+	if (frame_refcount(page) != 1 || frame_free_count() != free_before - 1)
+		result = FAIL;
+	frame_put(page);
+	if (frame_free_count() != free_before)
+		result = FAIL;
+	return result;
+}
+
+static int slab_ctor_calls;
+
+static void slab_test_ctor(void* obj){
+	*(uint32_t*)obj = 0x391;
+	slab_ctor_calls++;
+}
+
+/* slab_test
+ *
+ * Asserts that objects are constructed once per slab, come back in the
+ * constructed state, that a freed object is reused first and that the
+ * stats and frames add up once the cache is empty
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: registers a test cache
+ * Coverage: kmem_cache_init, kmem_cache_alloc, kmem_cache_free, kmem_cache_shrink
+ * Files: memory/slab.c/h
+ */
+int slab_test(){
+	TEST_HEADER;
+
+	static kmem_cache_t cache;
+	int result = PASS;
+	uint32_t i, free_before = frame_free_count();
+	uint32_t* objs[SLAB_MIN_OBJS];
+	uint32_t* again;
+	slab_ctor_calls = 0;
+	// caches are never unregistered, set it up once
+	if (cache.obj_size == 0 && kmem_cache_init(&cache, "test", 100, slab_test_ctor) != SUCCESS)
+		return FAIL;
+	for (i = 0; i < SLAB_MIN_OBJS; i++){
+		objs[i] = kmem_cache_alloc(&cache);
+		if (objs[i] == NULL || *objs[i] != 0x391)
+			result = FAIL;
+	}
+	if (slab_ctor_calls != cache.obj_per_slab || cache.obj_in_use != SLAB_MIN_OBJS)
+		result = FAIL;
+	kmem_cache_free(&cache, objs[1]);
+	again = kmem_cache_alloc(&cache);
+	if (again != objs[1] || slab_ctor_calls != cache.obj_per_slab)
+		result = FAIL;
+	for (i = 0; i < SLAB_MIN_OBJS; i++)
+		kmem_cache_free(&cache, objs[i]);
+	kmem_cache_shrink(&cache);
+	if (cache.obj_in_use != 0 || cache.slab_count != 0 || frame_free_count() != free_before)
+		result = FAIL;
+	return result;
+}
+
+/* image_share_test
+ *
+ * Asserts that two instances of a program map the same frames for the
+ * program file, read-only until written
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: the image of "shell" stays in the cache
+ * Coverage: image_map, vm_map_image
+ * Files: memory/image.c/h, memory/vm.c/h
+ */
+int image_share_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	dentry_t dentry;
+	inode_blk_t* inode;
+	pte_desc_t* first = vm_create();
+	pte_desc_t* second = vm_create();
+	uint32_t idx = (VIRTUAL_MEMORY_BASE_ADDRESS - USER_SPACE_BEGIN) >> FRAME_SHIFT;
+	if (first == NULL || second == NULL || read_dentry_by_name("shell", &dentry) == FAILURE){
+		vm_destroy(first);
+		vm_destroy(second);
+		return FAIL;
+	}
+	inode = (inode_blk_t*)fs_start_ptr + 1 + dentry.inode;
+	if (image_map(first, dentry.inode, inode->size, 0, VIRTUAL_MEMORY_BASE_ADDRESS, inode->size, 1) != SUCCESS
+		|| image_map(second, dentry.inode, inode->size, 0, VIRTUAL_MEMORY_BASE_ADDRESS, inode->size, 1) != SUCCESS)
+		result = FAIL;
+	else if (first[idx].base_addr != second[idx].base_addr || first[idx].read_write
+		|| !(first[idx].avail & PTE_COW))
+		result = FAIL;
+	vm_destroy(first);
+	vm_destroy(second);
+	return result;
+}
+
+/* user_writable_test
+ *
+ * Asserts that the check before kernel stores to user memory refuses
+ * read-only and unmapped pages, and makes the stack and shared pages
+ * writable
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: the image of "shell" stays in the cache
+ * Coverage: vm_user_writable
+ * Files: memory/vm.c/h
+ */
+int user_writable_test(){
+	TEST_HEADER;
+
+	static process_crtl_block_t pcb;
+	int result = PASS;
+	dentry_t dentry;
+	inode_blk_t* inode;
+	uint32_t text = VIRTUAL_MEMORY_BASE_ADDRESS;
+	uint32_t data = VIRTUAL_MEMORY_BASE_ADDRESS + USER_STACK_MAX;
+	uint32_t idx = (data - USER_SPACE_BEGIN) >> FRAME_SHIFT;
+	pcb.leader = &pcb;
+	pcb.brk = 0;
+	if ((pcb.user_pt = vm_create()) == NULL || read_dentry_by_name("shell", &dentry) == FAILURE){
+		vm_destroy(pcb.user_pt);
+		return FAIL;
+	}
+	inode = (inode_blk_t*)fs_start_ptr + 1 + dentry.inode;
+	if (image_map(pcb.user_pt, dentry.inode, inode->size, 0, text, FRAME_SIZE, 0) != SUCCESS
+		|| image_map(pcb.user_pt, dentry.inode, inode->size, 0, data, FRAME_SIZE, 1) != SUCCESS){
+		vm_destroy(pcb.user_pt);
+		return FAIL;
+	}
+	// read-only text, a hole below it, past the end and in the kernel
+	if (vm_user_writable(&pcb, text + 4, sizeof(uint32_t)) != FAILURE
+		|| vm_user_writable(&pcb, USER_SPACE_BEGIN, sizeof(uint32_t)) != FAILURE
+		|| vm_user_writable(&pcb, USER_SPACE_END - 2, sizeof(uint32_t)) != FAILURE
+		|| vm_user_writable(&pcb, (uint32_t)&pcb, sizeof(uint32_t)) != FAILURE)
+		result = FAIL;
+	// the stack is filled in, the copy-on-write page becomes private
+	if (vm_user_writable(&pcb, USER_SPACE_END - sizeof(uint32_t), sizeof(uint32_t)) != SUCCESS
+		|| !pcb.user_pt[((USER_SPACE_END - USER_SPACE_BEGIN) >> FRAME_SHIFT) - 1].read_write)
+		result = FAIL;
+	if (vm_user_writable(&pcb, data, FRAME_SIZE) != SUCCESS || !pcb.user_pt[idx].read_write
+		|| (pcb.user_pt[idx].avail & PTE_COW))
+		result = FAIL;
+	vm_destroy(pcb.user_pt);
+	pcb.user_pt = NULL;
+	return result;
+}
+
+/* elf_check_test
+ *
+ * Asserts that a program passes the ELF header check and a text file does not
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: elf_check
+ * Files: elf.c/h
+ */
+int elf_check_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	dentry_t dentry;
+	elf_header_t header;
+	inode_blk_t* inode;
+	if (read_dentry_by_name("shell", &dentry) == FAILURE)
+		return FAIL;
+	inode = (inode_blk_t*)fs_start_ptr + 1 + dentry.inode;
+	if (elf_check(dentry.inode, inode->size, &header) != SUCCESS || header.entry < VIRTUAL_MEMORY_BASE_ADDRESS)
+		result = FAIL;
+	if (read_dentry_by_name("frame0.txt", &dentry) == FAILURE)
+		return FAIL;
+	inode = (inode_blk_t*)fs_start_ptr + 1 + dentry.inode;
+	if (elf_check(dentry.inode, inode->size, &header) != FAILURE)
+		result = FAIL;
+	return result;
+}
+
+/* read_data_block_test
+ *
+ * Asserts that read_data_block points at the same bytes read_data copies,
+ * stops at block and file ends, and reports end of file
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: read_data_block
+ * Files: filesystem/filesys.c/h
+ */
+int read_data_block_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	dentry_t dentry;
+	inode_blk_t* inode;
+	const char* data;
+	char buf[16];
+	int32_t len;
+	if (read_dentry_by_name("frame0.txt", &dentry) == FAILURE)
+		return FAIL;
+	inode = (inode_blk_t*)fs_start_ptr + 1 + dentry.inode;
+	len = read_data_block(dentry.inode, 1, &data);
+	if (len != ((inode->size < FS_BLK_SIZE) ? inode->size - 1 : FS_BLK_SIZE - 1))
+		result = FAIL;
+	if (read_data(dentry.inode, 1, buf, sizeof(buf)) != sizeof(buf) || strncmp(buf, data, sizeof(buf)))
+		result = FAIL;
+	if (read_data_block(dentry.inode, inode->size - 1, &data) != 1)
+		result = FAIL;
+	if (read_data_block(dentry.inode, inode->size, &data) != 0)
+		result = FAIL;
+	return result;
+}
+
+/* lseek_test
+ *
+ * Asserts that lseek moves the file position from each whence, refuses
+ * files that cannot seek, and that pread leaves the position alone
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: needs the process made by test_file_operation2
+ * Coverage: lseek, pread
+ * Files: do_syscall.c/h
+ */
+int lseek_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	int32_t fd, size;
+	char first[4], again[4], direct[4];
+	if ((fd = open((uint8_t*)"frame0.txt")) == FAILURE)
+		return FAIL;
+	size = lseek(fd, 0, SEEK_END);
+	if (size <= (int32_t)sizeof(first) || lseek(fd, 0, SEEK_SET) != 0)
+		result = FAIL;
+	if (read(fd, first, sizeof(first)) != sizeof(first) || lseek(fd, -2, SEEK_CUR) != 2)
+		result = FAIL;
+	if (lseek(fd, -2, SEEK_CUR) != 0 || read(fd, again, sizeof(again)) != sizeof(again) || strncmp(first, again, sizeof(first)))
+		result = FAIL;
+	if (pread(fd, again, sizeof(again), 1) != sizeof(again) || pread(fd, direct, sizeof(direct), 0) != sizeof(direct))
+		result = FAIL;
+	if (strncmp(again, first + 1, sizeof(again) - 1) || strncmp(direct, first, sizeof(first)))
+		result = FAIL;
+	if (lseek(fd, 0, SEEK_CUR) != sizeof(first))
+		result = FAIL;
+	if (lseek(fd, -1, SEEK_SET) != FAILURE || lseek(fd, 0, 3) != FAILURE || lseek(1, 0, SEEK_SET) != FAILURE)
+		result = FAIL;
+	close(fd);
+	return result;
+}
+
+/* time_page_test
+ *
+ * Asserts that a tick moves the time page forward by one tick under an even
+ * sequence count, and that the date from it agrees with the CMOS
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: the clock runs one tick ahead
+ * Coverage: time_tick, cmos_read on the time page
+ * Files: timer.c/h
+ */
+int time_page_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint32_t seq, ticks, sec, nsec, offset = 0;
+	uint32_t flags;
+	char buf[TIMER_BUF_LEN], year[8];
+	if (time_page == NULL)
+		return FAIL;
+	cli_and_save(flags);
+	seq = time_page->seq;
+	ticks = time_page->ticks;
+	sec = time_page->mono_sec;
+	nsec = time_page->mono_nsec + time_page->tick_nsec;
+	time_tick();
+	if (nsec >= NSEC_PER_SEC){
+		nsec -= NSEC_PER_SEC;
+		sec++;
+	}
+	if ((seq & 1) || time_page->seq != seq + 2 || time_page->ticks != ticks + 1)
+		result = FAIL;
+	if (time_page->mono_sec != sec || time_page->mono_nsec != nsec)
+		result = FAIL;
+	restore_flags(flags);
+	// "yyyy/..." from the page against the CMOS year
+	if (cmos_read(0, &offset, buf, TIMER_BUF_LEN) != TIMER_BUF_LEN)
+		result = FAIL;
+	itoa(cmos_datetime().year, (int8_t*)year, 10);
+	if (strncmp(buf, year, 4))
+		result = FAIL;
+	return result;
+}
+
+/* tsc_test
+ *
+ * Asserts that one second of calibrated TSC cycles converts to one second,
+ * also past 32 bits of cycles, and that ktime_ns does not go back
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: tsc_init calibration, tsc_to_ns, ktime_ns
+ * Files: devices/tsc.c/h
+ */
+int tsc_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	uint64_t second, t0, t1, ns;
+	if (tsc_khz() == 0)
+		return PASS;
+	second = (uint64_t)tsc_khz() * 1000;
+	ns = tsc_to_ns(second);
+	if (ns < NSEC_PER_SEC - 1000 || ns > NSEC_PER_SEC + 1000)
+		result = FAIL;
+	// an hour of cycles is well past 2^32
+	ns = tsc_to_ns(second * 3600);
+	if (ns < (uint64_t)NSEC_PER_SEC * 3600 - 3600000 || ns > (uint64_t)NSEC_PER_SEC * 3600 + 3600000)
+		result = FAIL;
+	t0 = ktime_ns();
+	t1 = ktime_ns();
+	if (t1 < t0)
+		result = FAIL;
+	return result;
+}
+
+/* ktimer_test_fn
+ * timer callback for ktimer_test, records the tick it ran at
+ */
+static void ktimer_test_fn(uint32_t data){
+	*(uint32_t*)data = timer_ticks;
+}
+
+/* ktimer_test
+ *
+ * Asserts that timers in the first wheel level and ones that have to be
+ * cascaded down run on exactly their tick, and that a deleted timer never runs
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: advances the kernel clock by 300 ticks
+ * Coverage: add_timer, del_timer, timer_tick, run_timers, cascade, ms_to_ticks
+ * Files: ktimer.c/h
+ */
+int ktimer_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	ktimer_t near, far, gone;
+	uint32_t near_at = 0, far_at = 0, gone_at = 0;
+	uint32_t flags, start, i;
+	if (ms_to_ticks(0) != 0 || ms_to_ticks(1) != 1 || ms_to_ticks(10) != 1 || ms_to_ticks(11) != 2)
+		result = FAIL;
+	cli_and_save(flags);
+	start = timer_ticks;
+	init_timer(&near, ktimer_test_fn, (uint32_t)&near_at);
+	init_timer(&far, ktimer_test_fn, (uint32_t)&far_at);
+	init_timer(&gone, ktimer_test_fn, (uint32_t)&gone_at);
+	add_timer(&near, start + 3);
+	// past the first level, it is cascaded on the way
+	add_timer(&far, start + 300);
+	add_timer(&gone, start + 5);
+	if (!timer_pending(&far) || del_timer(&gone) != 1 || del_timer(&gone) != 0)
+		result = FAIL;
+	for (i = 0; i < 300; i++){
+		timer_tick();
+		run_timers();
+	}
+	restore_flags(flags);
+	if (near_at != start + 3 || far_at != start + 300 || gone_at != 0)
+		result = FAIL;
+	if (timer_pending(&near) || timer_pending(&far))
+		result = FAIL;
+	return result;
+}
+
+/* tickless_test
+ *
+ * Asserts that idle looks no further than the next pending timer and that
+ * stopping and restarting the tick right away loses no ticks
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: the PIT fires once more at the next tick boundary
+ * Coverage: next_timer_ticks, pit_idle_enter, pit_idle_exit
+ * Files: ktimer.c/h, devices/pit.c/h
+ */
+int tickless_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	ktimer_t timer;
+	uint32_t flags, ticks, start;
+	cli_and_save(flags);
+	init_timer(&timer, ktimer_test_fn, (uint32_t)&ticks);
+	add_timer(&timer, timer_ticks + 3);
+	ticks = next_timer_ticks(PIT_IDLE_MAX_TICKS);
+	if (ticks == 0 || ticks > 3)
+		result = FAIL;
+	del_timer(&timer);
+	start = timer_ticks;
+	pit_idle_enter();
+	pit_idle_exit();
+	if (timer_ticks != start)
+		result = FAIL;
+	restore_flags(flags);
+	return result;
+}
+
+/* rtc_hw_on
+ * 1 if the rtc periodic interrupt is enabled in register B
+ */
+static int rtc_hw_on(){
+	outb(RTC_SR_B, RTC_IO);
+	return (inb(CMOS_IO) & SIXTH_BIT) != 0;
+}
+
+/* rtc_virtual_test
+ *
+ * Asserts that each open rtc keeps its own frequency, that bad frequencies
+ * are refused and that the chip only interrupts while an rtc is open
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None, expects no other rtc to be open
+ * Coverage: rtc_open, rtc_write, rtc_close, hardware rate selection
+ * Files: devices/rtc.c/h
+ */
+int rtc_virtual_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	int32_t fast, slow;
+	fast = rtc_open();
+	slow = rtc_open();
+	if (fast == -1 || slow == -1)
+		return FAIL;
+	if (!rtc_hw_on())
+		result = FAIL;
+	if (rtc_write((rtc_file_t*)fast, 512) != 0 || rtc_write((rtc_file_t*)fast, 3) != -1
+		|| rtc_write((rtc_file_t*)slow, 2048) != -1)
+		result = FAIL;
+	// the failed writes leave both files alone
+	if (((rtc_file_t*)fast)->shift != 9 || ((rtc_file_t*)slow)->shift != 1)
+		result = FAIL;
+	rtc_close((rtc_file_t*)fast);
+	if (!rtc_hw_on())
+		result = FAIL;
+	rtc_close((rtc_file_t*)slow);
+	if (rtc_hw_on())
+		result = FAIL;
+	return result;
+}
+
+/* signal_mask_test
+ *
+ * Asserts that signals are kept as bits of the pending set, that a fresh
+ * pcb blocks nothing and that the faults can never be blocked
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: sig_init, signal_send, signal set layout
+ * Files: signal.c/h, process_crtl.h
+ */
+int signal_mask_test(){
+	TEST_HEADER;
+
+	static process_crtl_block_t pcb;
+	int result = PASS;
+	sig_init(&pcb);
+	if (pcb.sig_pending != 0 || pcb.sig_blocked != 0 || pcb.sig[NUM_SIGNAL - 1].signum != NUM_SIGNAL - 1)
+		result = FAIL;
+	signal_send(&pcb, ALARM);
+	signal_send(&pcb, CHILD);
+	signal_send(&pcb, ALARM);
+	if (pcb.sig_pending != (SIG_BIT(ALARM) | SIG_BIT(CHILD)))
+		result = FAIL;
+	// what sigprocmask keeps of a block-everything request
+	pcb.sig_blocked = SIG_ALL & ~SIG_UNBLOCKABLE;
+	if ((pcb.sig_pending & ~pcb.sig_blocked) != 0)
+		result = FAIL;
+	signal_send(&pcb, DIV_ZERO);
+	if ((pcb.sig_pending & ~pcb.sig_blocked) != SIG_BIT(DIV_ZERO))
+		result = FAIL;
+	return result;
+}
+
+/* signal_wake_test
+ *
+ * Asserts that a signal wakes a process sleeping on a futex only when it is
+ * not blocked and has a user handler or a default that halts, and that
+ * sending to no process is harmless
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: signal_send, signal_interrupts_sleep
+ * Files: signal.c/h, futex.c
+ */
+int signal_wake_test(){
+	TEST_HEADER;
+
+	static process_crtl_block_t pcb;
+	int result = PASS;
+	sig_init(&pcb);
+	// as futex_sleep leaves it, without being on a real queue
+	pcb.futex_key = 1;
+	pcb.is_running = NOT_RUNNING;
+	signal_send(NULL, INTERRUPT);
+	// CHILD is ignored by default
+	signal_send(&pcb, CHILD);
+	pcb.sig_blocked = SIG_BIT(ALARM);
+	signal_send(&pcb, ALARM);
+	if (pcb.is_running != NOT_RUNNING || signal_interrupts_sleep(&pcb))
+		result = FAIL;
+	// the periodic ALARM every process gets does nothing by default
+	pcb.sig_blocked = 0;
+	signal_send(&pcb, ALARM);
+	if (pcb.is_running != NOT_RUNNING || signal_interrupts_sleep(&pcb))
+		result = FAIL;
+	pcb.sig[USER1].sig_handler = (signal_handler)USER_MEMORY;
+	signal_send(&pcb, USER1);
+	if (pcb.is_running != RUNNING)
+		result = FAIL;
+	pcb.sig_pending = 0;
+	pcb.is_running = NOT_RUNNING;
+	signal_send(&pcb, INTERRUPT);
+	if (pcb.is_running != RUNNING || !signal_interrupts_sleep(&pcb))
+		result = FAIL;
+	return result;
+}
+
+/* softirq_test_fn
+ * work callback for softirq_test, counts calls and whether they ran from
+ * inside do_softirq
+ */
+static void softirq_test_fn(uint32_t data){
+	*(int32_t*)data += in_softirq() ? 10 : 1;
+}
+
+/* softirq_test
+ *
+ * Asserts that scheduled work runs once from do_softirq, that scheduling it
+ * twice before it runs queues it once and that it can be scheduled again
+ * after it ran
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: runs every pending softirq
+ * Coverage: init_work, schedule_work, do_softirq, in_softirq
+ * Files: softirq.c/h
+ */
+int softirq_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	work_t work;
+	int32_t count = 0;
+	init_work(&work, softirq_test_fn, (uint32_t)&count);
+	if (schedule_work(&work) != 1 || schedule_work(&work) != 0 || !softirq_pending())
+		result = FAIL;
+	do_softirq();
+	if (count != 10 || work.queued || in_softirq())
+		result = FAIL;
+	if (schedule_work(&work) != 1)
+		result = FAIL;
+	do_softirq();
+	if (count != 20)
+		result = FAIL;
+	return result;
+}
+
+/* pipe_test
+ *
+ * Asserts that bytes come out of a pipe in order and that the reader sees
+ * end of file once the write end is closed
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: pipe_create, pipe_read, pipe_write, pipe close
+ * Files: pipe.c/h
+ */
+int pipe_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	file_desc_entry_t read_end, write_end;
+	char buf[8];
+	uint32_t free_before;
+	// cached empty slabs would hide a leak
+	kmem_reap();
+	free_before = frame_free_count();
+	if (pipe_create(&read_end, &write_end) != SUCCESS)
+		return FAIL;
+	if (write_end.file_op.write(write_end.inode, "391", 3) != 3)
+		result = FAIL;
+	if (read_end.file_op.read(read_end.inode, &read_end.file_pos, buf, 2) != 2 || strncmp(buf, "39", 2))
+		result = FAIL;
+	write_end.file_op.close(&write_end.inode);
+	// what is left, then end of file
+	if (read_end.file_op.read(read_end.inode, &read_end.file_pos, buf, 8) != 1 || buf[0] != '1')
+		result = FAIL;
+	if (read_end.file_op.read(read_end.inode, &read_end.file_pos, buf, 8) != 0)
+		result = FAIL;
+	read_end.file_op.close(&read_end.inode);
+	kmem_reap();
+	if (frame_free_count() != free_before)
+		result = FAIL;
+	return result;
+}
+
+/* fd_table_test
+ *
+ * Asserts that an fd table hands out the lowest free fd, grows past its
+ * inline slots, and gives everything back when destroyed
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: fd_install, fd_set, fd_remove, fd table growth, file refcounts
+ * Files: filesystem/file.c/h
+ */
+int fd_table_test(){
+	TEST_HEADER;
+
+	int result = PASS;
+	fd_table_t table;
+	file_desc_entry_t* file;
+	int32_t fd;
+	uint32_t free_before;
+	kmem_reap();
+	free_before = frame_free_count();
+	fd_table_init(&table);
+	// one file behind every fd, each fd holds a reference
+	if ((file = file_alloc()) == NULL)
+		return FAIL;
+	for (fd = 0; fd < 3 * FD_INLINE; fd++){
+		file_get(file);
+		if (fd_install(&table, file) != fd)
+			result = FAIL;
+	}
+	if (table.size < 3 * FD_INLINE || table.order < 0)
+		result = FAIL;
+	// the lowest hole is reused
+	if (fd_remove(&table, 5) != file || fd_install(&table, file) != 5)
+		result = FAIL;
+	if (fd_set(&table, FD_MAX - 1, file) != SUCCESS || fd_get(&table, FD_MAX - 1) != file)
+		result = FAIL;
+	if (fd_set(&table, FD_MAX, file) != FAILURE || fd_get(&table, FD_MAX) != NULL)
+		result = FAIL;
+	// our own reference is the only one left after the table goes
+	fd_table_destroy(&table);
+	if (file->refcount != 1 || table.size != FD_INLINE)
+		result = FAIL;
+	file_put(file);
+	kmem_reap();
+	if (frame_free_count() != free_before)
+		result = FAIL;
+	return result;
+}
+
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
@@ -1069,5 +1792,28 @@ void launch_tests(){
     // test_file_operation1();
     test_file_operation2();
 
+    /* memory management */
+    TEST_OUTPUT("frame_alloc_test", frame_alloc_test());
+    TEST_OUTPUT("frame_share_test", frame_share_test());
+    TEST_OUTPUT("slab_test", slab_test());
+    TEST_OUTPUT("image_share_test", image_share_test());
+    TEST_OUTPUT("user_writable_test", user_writable_test());
+    TEST_OUTPUT("elf_check_test", elf_check_test());
+    TEST_OUTPUT("read_data_block_test", read_data_block_test());
+    TEST_OUTPUT("lseek_test", lseek_test());
+
+    TEST_OUTPUT("time_page_test", time_page_test());
+    TEST_OUTPUT("tsc_test", tsc_test());
+    TEST_OUTPUT("ktimer_test", ktimer_test());
+    TEST_OUTPUT("tickless_test", tickless_test());
+    TEST_OUTPUT("rtc_virtual_test", rtc_virtual_test());
+    TEST_OUTPUT("signal_mask_test", signal_mask_test());
+    TEST_OUTPUT("signal_wake_test", signal_wake_test());
+    TEST_OUTPUT("softirq_test", softirq_test());
+
+    /* ipc */
+    TEST_OUTPUT("pipe_test", pipe_test());
+    TEST_OUTPUT("fd_table_test", fd_table_test());
+
     #endif
 }
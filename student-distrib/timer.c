@@ -1,4 +1,10 @@
 #include "timer.h"
+#include "memory/vm.h"
+
+time_page_t* time_page = NULL;
+
+static uint32_t days_from_civil(uint32_t year, uint32_t month, uint32_t day);
+static datetime_t time_datetime();
 
 
 // reference : https://wiki.osdev.org/CMOS
@@ -53,6 +59,94 @@ datetime_t cmos_datetime() {
     return ret;
 }
 
+/* uint32_t days_from_civil(uint32_t year, uint32_t month, uint32_t day)
+ * input: a date, year 1970 or later
+ * output: ret val - days since 1970/01/01
+ * description: proleptic gregorian calendar, march based years so the
+ *              leap day is the last day of a year.
+ */
+static uint32_t days_from_civil(uint32_t year, uint32_t month, uint32_t day) {
+    uint32_t era, yoe, doy, doe;
+    if (month <= 2) year--;
+    era = year / 400;
+    yoe = year - era * 400;
+    doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/* void time_init()
+ * description: allocate the time page and start its wall clock from the
+ *              CMOS, the only CMOS read the clock needs.
+ */
+void time_init() {
+    uint32_t frame = alloc_pages(FRAME_ORDER_4KB);
+    datetime_t now;
+    if (frame == 0) return;
+    memset((void*)frame, 0, FRAME_SIZE);
+    time_page = (time_page_t*)frame;
+    time_page->tick_nsec = TICK_NSEC;
+    now = cmos_datetime();
+    time_page->boot_sec = days_from_civil(now.year, now.month, now.day) * 86400
+                        + now.hour * 3600 + now.minute * 60 + now.second;
+}
+
+/* void time_tick()
+ * description: advance the clock by one PIT tick, called from the PIT
+ *              interrupt with interrupts off.
+ */
+void time_tick() {
+    if (time_page == NULL) return;
+    time_page->seq++;
+    asm volatile ("" : : : "memory");
+    time_page->ticks++;
+    time_page->mono_nsec += time_page->tick_nsec;
+    if (time_page->mono_nsec >= NSEC_PER_SEC) {
+        time_page->mono_nsec -= NSEC_PER_SEC;
+        time_page->mono_sec++;
+    }
+    asm volatile ("" : : : "memory");
+    time_page->seq++;
+}
+
+/* datetime_t time_datetime()
+ * output: ret val - structure of current datetime
+ * description: the wall clock of the time page as a date, inverse of
+ *              days_from_civil. No CMOS access.
+ */
+static datetime_t time_datetime() {
+    uint32_t sec, era, doe, yoe, doy, mp, days;
+    datetime_t ret;
+    do {
+        while ((doe = time_page->seq) & 1);
+        sec = time_page->boot_sec + time_page->mono_sec;
+    } while (doe != time_page->seq);
+    days = sec / 86400 + 719468;
+    sec %= 86400;
+    era = days / 146097;
+    doe = days - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    ret.day = doy - (153 * mp + 2) / 5 + 1;
+    ret.month = mp < 10 ? mp + 3 : mp - 9;
+    ret.year = yoe + era * 400 + (ret.month <= 2);
+    ret.hour = sec / 3600;
+    ret.minute = sec / 60 % 60;
+    ret.second = sec % 60;
+    return ret;
+}
+
+/* int32_t time_map(pte_desc_t* user_pt)
+ * input: user_pt - page table of a new address space
+ * output: ret val (SUCCESS) / (FAILURE)
+ * description: map the time page read-only at TIME_PAGE_ADDRESS.
+ */
+int32_t time_map(pte_desc_t* user_pt) {
+    if (time_page == NULL) return SUCCESS;
+    return vm_map_image(user_pt, TIME_PAGE_ADDRESS, (uint32_t)time_page, 0);
+}
+
 // a common API for time read.
 file_ops_table_t cmos_if = {
     .open = cmos_open,
@@ -75,17 +169,18 @@ int32_t cmos_open(const uint8_t* filename) {
  *         buf - buffer to write to
  *         len - max number of characters to write into
  * output: buf - written with datetime information
- *          ret val (SUCCESS) / (FAIL)
+ *          ret val (SUCCESS) / (FAILURE)
  * description: formats date time and writes them into buffer.
  */
 int32_t cmos_read(int32_t inode, uint32_t* offset, void* buf, int32_t nbytes) {
-    if(NULL == buf || NULL == offset) return FAIL;
+    if(NULL == buf || NULL == offset) return FAILURE;
     char tmp[] = "0000/00/00 00:00:00\n";
-    if(nbytes < strlen(tmp)) return FAIL;
+    if(nbytes < strlen(tmp)) return FAILURE;
     if(0 != *offset) return 0;
 
     *offset = 1;    // Mark that we've outputted the date time
-    datetime_t datetime = cmos_datetime();
+    // the time page follows the CMOS from boot on without polling it
+    datetime_t datetime = (time_page != NULL) ? time_datetime() : cmos_datetime();
     // Concatenating each segment of date time
     // Each number represents offset in output string, whose format is defined above
     itoa(datetime.year, (int8_t*) (tmp), 10);
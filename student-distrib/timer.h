@@ -3,6 +3,7 @@
 
 #include "lib.h"
 #include "filesystem/filesys.h"
+#include "x86_desc.h"
 
 #define CMOS_PORT_INDEX 0x70
 #define CMOS_PORT_DATA 0x71
@@ -17,7 +18,11 @@
 #define CMOS_REG_TIME_UPDATING_MASK 0x80
 
 #define SUCCESS 0
-#define FAIL    -1
+#define FAILURE -1
+
+/* the PIT runs at 100HZ */
+#define TICK_NSEC       10000000
+#define NSEC_PER_SEC    1000000000
 
 
 // used to count time.
@@ -30,6 +35,27 @@ typedef struct {
     uint8_t second;
 } datetime_t;
 
+/* the time page, mapped read-only at TIME_PAGE_ADDRESS in every process so
+ * programs read the clock without a system call. The tick handler makes seq
+ * odd, updates the page and makes seq even again; readers retry while seq
+ * is odd or changed under them. ece391support.c has the same layout. */
+typedef struct {
+    volatile uint32_t seq;
+    uint32_t tick_nsec;
+    uint32_t ticks;
+    // monotonic time since boot
+    uint32_t mono_sec;
+    uint32_t mono_nsec;
+    // wall clock seconds (1970 based, CMOS time zone) at mono time 0
+    uint32_t boot_sec;
+} time_page_t;
+
+extern time_page_t* time_page;
+
+void time_init(void);
+void time_tick(void);
+int32_t time_map(pte_desc_t* user_pt);
+
 uint8_t cmos_reg_read(uint8_t index);
 void cmos_reg_write(uint8_t index, uint8_t data);
 datetime_t cmos_datetime();
@@ -277,7 +277,6 @@ typedef union{
 
 extern pde_desc_t page_directory[PAGE_ENTRY_NUM];
 extern pte_desc_t page_table[PAGE_ENTRY_NUM];
-extern pte_desc_t user_page_4K[PAGE_ENTRY_NUM];
 
 #endif /* ASM */
 
@@ -0,0 +1,34 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 32
+
+int main ()
+{
+    int32_t pid;
+    uint8_t buf[BUFSIZE];
+    /* written after the fork, each process must see its own copy */
+    uint8_t owner[BUFSIZE] = "nobody";
+
+    if (-1 == (pid = ece391_fork ())) {
+        ece391_fdputs (1, (uint8_t*)"fork failed\n");
+        return 3;
+    }
+    if (0 == pid) {
+        ece391_strcpy (owner, (uint8_t*)"child");
+        ece391_fdputs (1, (uint8_t*)"child: owner is ");
+        ece391_fdputs (1, owner);
+        ece391_fdputs (1, (uint8_t*)"\n");
+        return 0;
+    }
+    ece391_strcpy (owner, (uint8_t*)"parent");
+    ece391_fdputs (1, (uint8_t*)"parent: forked pid ");
+    ece391_fdputs (1, ece391_itoa (pid, buf, 10));
+    ece391_fdputs (1, (uint8_t*)", owner is ");
+    ece391_fdputs (1, owner);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    return 0;
+}
@@ -6,22 +6,38 @@
 #define BUFSIZE 1024
 #define SBUFSIZE 33
 
+/* search every line read from fd, fname prefixes matches unless 0 */
 int32_t
-do_one_file (const char* s, const char* fname) 
+do_one_fd (const char* s, int32_t fd, const char* fname) 
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
-    uint8_t data[BUFSIZE+1];
+    int32_t cnt, last, line_start, line_end, check, s_len, size, i;
+    uint8_t *data, *bigger;
 
-    s_len = ece391_strlen ((uint8_t*)s);
-    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
-        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+    /* the buffer doubles whenever a single line does not fit */
+    size = BUFSIZE;
+    if (0 == (data = ece391_malloc (size + 1))) {
+        ece391_fdputs (1, (uint8_t*)"out of memory\n");
         return -1;
     }
+    s_len = ece391_strlen ((uint8_t*)s);
     last = 0;
     while (1) {
-        cnt = ece391_read (fd, data + last, BUFSIZE - last);
+	if (last == size) {
+	    if (0 == (bigger = ece391_malloc (2 * size + 1))) {
+		ece391_fdputs (1, (uint8_t*)"out of memory\n");
+		ece391_free (data);
+		return -1;
+	    }
+	    for (i = 0; i < last; i++)
+		bigger[i] = data[i];
+	    ece391_free (data);
+	    data = bigger;
+	    size *= 2;
+	}
+        cnt = ece391_read (fd, data + last, size - last);
 	if (-1 == cnt) {
             ece391_fdputs (1, (uint8_t*)"file read failed\n");
+            ece391_free (data);
             return -1;
 	}
 	last += cnt;
@@ -30,8 +46,9 @@ do_one_file (const char* s, const char* fname)
 	    line_end = line_start;
 	    while (line_end < last && '\n' != data[line_end])
 		line_end++;
-	    if ('\n' != data[line_end] && 0 != cnt && line_start != 0) {
-		/* copy from line_start to last down to 0 and fix last */
+	    if (line_end == last && 0 != cnt) {
+		/* partial line: copy from line_start to last down to 0, fix
+		   last and read the rest of it */
 		data[line_end] = '\0';
 		ece391_strcpy (data, data + line_start);
 		last -= line_start;
@@ -42,8 +59,10 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
+		    if (0 != fname) {
+			ece391_fdputs (1, (uint8_t*)fname);
+			ece391_fdputs (1, (uint8_t*)":");
+		    }
 		    ece391_fdputs (1, data + line_start);
 		    ece391_fdputs (1, (uint8_t*)"\n");
 		    break;
@@ -58,6 +77,21 @@ do_one_file (const char* s, const char* fname)
 	if (0 == cnt)
 	    break;
     }
+    ece391_free (data);
+    return 0;
+}
+
+int32_t
+do_one_file (const char* s, const char* fname) 
+{
+    int32_t fd;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
+        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+        return -1;
+    }
+    if (0 != do_one_fd (s, fd, fname))
+        return -1;
     if (-1 == ece391_close (fd)) {
         ece391_fdputs (1, (uint8_t*)"file close failed\n");
         return -1;
@@ -76,6 +110,10 @@ int main ()
         return 3;
     }
 
+    /* in a pipeline, search what comes down the pipe instead */
+    if (0 == ece391_isatty (0))
+        return (0 != do_one_fd ((char*)search, 0, 0)) ? 3 : 0;
+
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
 	return 2;
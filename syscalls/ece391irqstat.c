@@ -0,0 +1,46 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define NUM_IRQ 16
+#define SECONDS 2
+
+static const char* names[NUM_IRQ] = {
+    "pit", "keyboard", 0, 0, 0, 0, 0, 0,
+    "rtc", 0, 0, 0, "mouse", 0, 0, 0
+};
+
+/* interrupts per second of every irq while this program sleeps, with the
+   system otherwise idle the pit line shows how many ticks idle skipped */
+int
+main ()
+{
+    uint32_t before[NUM_IRQ], after[NUM_IRQ];
+    uint8_t buf[16];
+    int32_t i;
+
+    if (NUM_IRQ != ece391_irqstat (before, NUM_IRQ) ||
+	0 != ece391_sleep_ms (SECONDS * 1000) ||
+	NUM_IRQ != ece391_irqstat (after, NUM_IRQ)) {
+	ece391_fdputs (1, (uint8_t*)"irqstat failed\n");
+	return 3;
+    }
+    for (i = 0; i < NUM_IRQ; i++) {
+	if (after[i] == before[i])
+	    continue;
+	ece391_fdputs (1, (uint8_t*)"irq ");
+	ece391_itoa (i, buf, 10);
+	ece391_fdputs (1, buf);
+	if (names[i] != 0) {
+	    ece391_fdputs (1, (uint8_t*)" (");
+	    ece391_fdputs (1, (uint8_t*)names[i]);
+	    ece391_fdputs (1, (uint8_t*)")");
+	}
+	ece391_fdputs (1, (uint8_t*)": ");
+	ece391_itoa ((after[i] - before[i]) / SECONDS, buf, 10);
+	ece391_fdputs (1, buf);
+	ece391_fdputs (1, (uint8_t*)" per second\n");
+    }
+    return 0;
+}
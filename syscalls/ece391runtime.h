@@ -0,0 +1,64 @@
+/*
+ * Functions exported by the shared runtime image (libece391). The runtime
+ * starts with a table of their addresses in this order and programs built
+ * with "make shared" jump through it, so only ever append to this list.
+ * Include after defining RUNTIME_ENTRY(name).
+ */
+RUNTIME_ENTRY(ece391_halt)
+RUNTIME_ENTRY(ece391_execute)
+RUNTIME_ENTRY(ece391_read)
+RUNTIME_ENTRY(ece391_write)
+RUNTIME_ENTRY(ece391_open)
+RUNTIME_ENTRY(ece391_close)
+RUNTIME_ENTRY(ece391_getargs)
+RUNTIME_ENTRY(ece391_vidmap)
+RUNTIME_ENTRY(ece391_set_handler)
+RUNTIME_ENTRY(ece391_sigreturn)
+RUNTIME_ENTRY(ece391_beep)
+RUNTIME_ENTRY(ece391_ps)
+RUNTIME_ENTRY(ece391_random)
+RUNTIME_ENTRY(ece391_fork)
+RUNTIME_ENTRY(ece391_thread_create)
+RUNTIME_ENTRY(ece391_thread_exit)
+RUNTIME_ENTRY(ece391_thread_join)
+RUNTIME_ENTRY(ece391_futex_wait)
+RUNTIME_ENTRY(ece391_futex_wake)
+RUNTIME_ENTRY(ece391_pipe)
+RUNTIME_ENTRY(ece391_isatty)
+RUNTIME_ENTRY(ece391_shm_create)
+RUNTIME_ENTRY(ece391_shm_attach)
+RUNTIME_ENTRY(ece391_shm_detach)
+RUNTIME_ENTRY(ece391_spawn)
+RUNTIME_ENTRY(ece391_waitpid)
+RUNTIME_ENTRY(ece391_strlen)
+RUNTIME_ENTRY(ece391_strcpy)
+RUNTIME_ENTRY(ece391_fdputs)
+RUNTIME_ENTRY(ece391_strcmp)
+RUNTIME_ENTRY(ece391_strncmp)
+RUNTIME_ENTRY(ece391_itoa)
+RUNTIME_ENTRY(ece391_strrev)
+RUNTIME_ENTRY(ece391_atoi)
+RUNTIME_ENTRY(ece391_mutex_init)
+RUNTIME_ENTRY(ece391_mutex_lock)
+RUNTIME_ENTRY(ece391_mutex_unlock)
+RUNTIME_ENTRY(ece391_cond_init)
+RUNTIME_ENTRY(ece391_cond_wait)
+RUNTIME_ENTRY(ece391_cond_signal)
+RUNTIME_ENTRY(ece391_cond_broadcast)
+RUNTIME_ENTRY(ece391_sbrk)
+RUNTIME_ENTRY(ece391_malloc)
+RUNTIME_ENTRY(ece391_free)
+RUNTIME_ENTRY(ece391_dup)
+RUNTIME_ENTRY(ece391_dup2)
+RUNTIME_ENTRY(ece391_sendfile)
+RUNTIME_ENTRY(ece391_lseek)
+RUNTIME_ENTRY(ece391_pread)
+RUNTIME_ENTRY(ece391_fast_syscall)
+RUNTIME_ENTRY(ece391_null)
+RUNTIME_ENTRY(ece391_clock_gettime)
+RUNTIME_ENTRY(ece391_time)
+RUNTIME_ENTRY(ece391_gettime_ns)
+RUNTIME_ENTRY(ece391_sleep_ms)
+RUNTIME_ENTRY(ece391_alarm)
+RUNTIME_ENTRY(ece391_irqstat)
+RUNTIME_ENTRY(ece391_sigprocmask)
@@ -5,13 +5,31 @@
 
 #define BUFSIZE 1024
 
+/* report background jobs that have halted since the last prompt */
+static void
+reap_jobs (void)
+{
+    int32_t pid, status;
+    uint8_t num[12];
+
+    while (0 < (pid = ece391_waitpid (-1, &status, WNOHANG))) {
+	ece391_fdputs (1, (uint8_t*)"[");
+	ece391_fdputs (1, ece391_itoa (pid, num, 10));
+	ece391_fdputs (1, (uint8_t*)"] done, status ");
+	ece391_fdputs (1, ece391_itoa (status, num, 10));
+	ece391_fdputs (1, (uint8_t*)"\n");
+    }
+}
+
 int main ()
 {
     int32_t cnt, rval;
     uint8_t buf[BUFSIZE];
+    uint8_t num[12];
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
+	reap_jobs ();
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -24,6 +42,19 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
+	/* "cmd &" runs in the background, the prompt comes back at once */
+	if (cnt > 0 && '&' == buf[cnt - 1]) {
+	    for (buf[--cnt] = '\0'; cnt > 0 && ' ' == buf[cnt - 1]; )
+		buf[--cnt] = '\0';
+	    if (-1 == (rval = ece391_spawn (buf))) {
+		ece391_fdputs (1, (uint8_t*)"no such command\n");
+		continue;
+	    }
+	    ece391_fdputs (1, (uint8_t*)"[");
+	    ece391_fdputs (1, ece391_itoa (rval, num, 10));
+	    ece391_fdputs (1, (uint8_t*)"]\n");
+	    continue;
+	}
 	rval = ece391_execute (buf);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
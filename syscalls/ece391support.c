@@ -112,3 +112,227 @@ int32_t ece391_atoi(uint8_t* string)
     }
     return number;
 }
+
+/* atomic helpers, each one locked instruction */
+static int32_t cmpxchg(volatile int32_t* p, int32_t old, int32_t new)
+{
+    int32_t prev;
+    asm volatile ("lock; cmpxchgl %2, %1"
+                  : "=a"(prev), "+m"(*p)
+                  : "r"(new), "0"(old)
+                  : "memory", "cc");
+    return prev;
+}
+
+static int32_t xchg(volatile int32_t* p, int32_t val)
+{
+    asm volatile ("xchgl %0, %1"
+                  : "+r"(val), "+m"(*p)
+                  :
+                  : "memory");
+    return val;
+}
+
+static int32_t fetch_add(volatile int32_t* p, int32_t val)
+{
+    asm volatile ("lock; xaddl %0, %1"
+                  : "+r"(val), "+m"(*p)
+                  :
+                  : "memory", "cc");
+    return val;
+}
+
+void ece391_mutex_init(ece391_mutex_t* m)
+{
+    m->state = 0;
+}
+
+void ece391_mutex_lock(ece391_mutex_t* m)
+{
+    int32_t c;
+
+    /* uncontended: 0 -> 1 without entering the kernel */
+    if (0 == (c = cmpxchg (&m->state, 0, 1)))
+        return;
+    /* mark it contended so the owner knows to wake us */
+    if (2 != c)
+        c = xchg (&m->state, 2);
+    while (0 != c) {
+        ece391_futex_wait (&m->state, 2);
+        c = xchg (&m->state, 2);
+    }
+}
+
+void ece391_mutex_unlock(ece391_mutex_t* m)
+{
+    /* 1 -> 0 means nobody sleeps on it */
+    if (1 != fetch_add (&m->state, -1)) {
+        m->state = 0;
+        ece391_futex_wake (&m->state, 1);
+    }
+}
+
+void ece391_cond_init(ece391_cond_t* c)
+{
+    c->seq = 0;
+}
+
+void ece391_cond_wait(ece391_cond_t* c, ece391_mutex_t* m)
+{
+    int32_t seq = c->seq;
+
+    ece391_mutex_unlock (m);
+    /* returns at once if a signal bumped seq after the unlock */
+    ece391_futex_wait (&c->seq, seq);
+    /* other waiters may be woken with us, relock as contended */
+    while (0 != xchg (&m->state, 2))
+        ece391_futex_wait (&m->state, 2);
+}
+
+void ece391_cond_signal(ece391_cond_t* c)
+{
+    fetch_add (&c->seq, 1);
+    ece391_futex_wake (&c->seq, 1);
+}
+
+void ece391_cond_broadcast(ece391_cond_t* c)
+{
+    fetch_add (&c->seq, 1);
+    ece391_futex_wake (&c->seq, 0x7FFFFFFF);
+}
+
+/*
+ * malloc: blocks of 16 to 2048 bytes come from one free list per power of
+ * two size, refilled a page at a time from sbrk. Larger blocks get their
+ * own sbrk range and are reused first-fit once freed.
+ */
+#define MALLOC_MIN_SHIFT	4
+#define MALLOC_CLASSES		8
+#define MALLOC_PAGE		4096
+
+typedef struct malloc_block {
+    uint32_t size;			/* usable bytes after the header */
+    struct malloc_block* next;		/* free list link while free */
+} malloc_block_t;
+
+static malloc_block_t* malloc_free[MALLOC_CLASSES];
+static malloc_block_t* malloc_large;
+
+static malloc_block_t* malloc_refill(int32_t c)
+{
+    uint32_t size = 1 << (c + MALLOC_MIN_SHIFT);
+    uint32_t step = sizeof(malloc_block_t) + size;
+    uint32_t i, n = MALLOC_PAGE / step;
+    uint8_t* page;
+    malloc_block_t* b;
+
+    if (0 == n)
+	n = 1;
+    page = ece391_sbrk (n * step);
+    if ((void*)-1 == page)
+	return 0;
+    for (i = 0; i < n; i++) {
+	b = (malloc_block_t*)(page + i * step);
+	b->size = size;
+	b->next = malloc_free[c];
+	malloc_free[c] = b;
+    }
+    return malloc_free[c];
+}
+
+void* ece391_malloc(uint32_t size)
+{
+    malloc_block_t* b;
+    malloc_block_t** link;
+    int32_t c;
+
+    if (0 == size)
+	return 0;
+    for (c = 0; c < MALLOC_CLASSES && (1U << (c + MALLOC_MIN_SHIFT)) < size; c++);
+    if (c < MALLOC_CLASSES) {
+	if (0 == malloc_free[c] && 0 == malloc_refill (c))
+	    return 0;
+	b = malloc_free[c];
+	malloc_free[c] = b->next;
+	return b + 1;
+    }
+    size = (size + 3) & ~3;
+    for (link = &malloc_large; 0 != *link; link = &(*link)->next) {
+	if ((*link)->size >= size) {
+	    b = *link;
+	    *link = b->next;
+	    return b + 1;
+	}
+    }
+    b = ece391_sbrk (sizeof(malloc_block_t) + size);
+    if ((void*)-1 == b)
+	return 0;
+    b->size = size;
+    return b + 1;
+}
+
+void ece391_free(void* ptr)
+{
+    malloc_block_t* b;
+    int32_t c;
+
+    if (0 == ptr)
+	return;
+    b = (malloc_block_t*)ptr - 1;
+    for (c = 0; c < MALLOC_CLASSES; c++) {
+	if (b->size == (1U << (c + MALLOC_MIN_SHIFT))) {
+	    b->next = malloc_free[c];
+	    malloc_free[c] = b;
+	    return;
+	}
+    }
+    b->next = malloc_large;
+    malloc_large = b;
+}
+
+/*
+ * clock: the kernel keeps the time in a read-only page below the program,
+ * updated every tick under a sequence count. Same layout as time_page_t in
+ * the kernel's timer.h.
+ */
+#define TIME_PAGE		0x08047000
+#define NSEC_PER_SEC		1000000000
+
+typedef struct {
+    volatile uint32_t seq;
+    uint32_t tick_nsec;
+    uint32_t ticks;
+    uint32_t mono_sec;
+    uint32_t mono_nsec;
+    uint32_t boot_sec;
+} time_page_t;
+
+int32_t ece391_clock_gettime(int32_t clock, ece391_timespec_t* ts)
+{
+    const time_page_t* tp = (const time_page_t*)TIME_PAGE;
+    uint32_t seq, sec, nsec;
+
+    if (0 == ts || (ECE391_CLOCK_REALTIME != clock && ECE391_CLOCK_MONOTONIC != clock))
+	return -1;
+    do {
+	/* odd while the kernel is in the middle of an update */
+	while (1 & (seq = tp->seq));
+	asm volatile ("" : : : "memory");
+	sec = tp->mono_sec;
+	nsec = tp->mono_nsec;
+	if (ECE391_CLOCK_REALTIME == clock)
+	    sec += tp->boot_sec;
+	asm volatile ("" : : : "memory");
+    } while (seq != tp->seq);
+    ts->sec = sec;
+    ts->nsec = nsec;
+    return 0;
+}
+
+uint32_t ece391_time(void)
+{
+    ece391_timespec_t ts;
+
+    ece391_clock_gettime (ECE391_CLOCK_REALTIME, &ts);
+    return ts.sec;
+}
@@ -10,4 +10,39 @@ extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
 extern int32_t ece391_atoi(uint8_t* string);
 
+/* heap from ece391_sbrk, returns 0 when out of memory */
+extern void* ece391_malloc(uint32_t size);
+extern void ece391_free(void* ptr);
+
+/* 0 unlocked, 1 locked, 2 locked with sleepers */
+typedef struct {
+    volatile int32_t state;
+} ece391_mutex_t;
+
+/* bumped by every signal, waiters sleep on the value they saw */
+typedef struct {
+    volatile int32_t seq;
+} ece391_cond_t;
+
+extern void ece391_mutex_init(ece391_mutex_t* m);
+extern void ece391_mutex_lock(ece391_mutex_t* m);
+extern void ece391_mutex_unlock(ece391_mutex_t* m);
+extern void ece391_cond_init(ece391_cond_t* c);
+extern void ece391_cond_wait(ece391_cond_t* c, ece391_mutex_t* m);
+extern void ece391_cond_signal(ece391_cond_t* c);
+extern void ece391_cond_broadcast(ece391_cond_t* c);
+
+/* read from the kernel's time page, no system call. Monotonic counts from
+   boot, realtime is seconds since 1970 in the CMOS time zone. */
+#define ECE391_CLOCK_REALTIME	0
+#define ECE391_CLOCK_MONOTONIC	1
+
+typedef struct {
+    uint32_t sec;
+    uint32_t nsec;
+} ece391_timespec_t;
+
+extern int32_t ece391_clock_gettime(int32_t clock, ece391_timespec_t* ts);
+extern uint32_t ece391_time(void);
+
 #endif /* ECE391SUPPORT_H */
@@ -0,0 +1,49 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ROUNDS 100000
+
+static uint32_t
+rdtsc_low (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+/* average cycles of one null system call on the path picked by enable */
+static uint32_t
+measure (int32_t enable)
+{
+    uint32_t i, start;
+
+    ece391_fast_syscall (enable);
+    start = rdtsc_low ();
+    for (i = 0; i < ROUNDS; i++)
+	ece391_null ();
+    return (rdtsc_low () - start) / ROUNDS;
+}
+
+static void
+report (const char* name, uint32_t cycles)
+{
+    uint8_t buf[16];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_itoa (cycles, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" cycles per call\n");
+}
+
+int
+main ()
+{
+    report ("int $0x80: ", measure (0));
+    if (1 == ece391_fast_syscall (1))
+	report ("sysenter:  ", measure (1));
+    else
+	ece391_fdputs (1, (uint8_t*)"sysenter:  not supported\n");
+    return 0;
+}
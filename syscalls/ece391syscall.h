@@ -24,6 +24,55 @@ extern int32_t ece391_sigreturn (void);
 extern int32_t ece391_beep(void);
 extern int32_t ece391_ps(void);
 extern int32_t ece391_random(void);
+extern int32_t ece391_fork(void);
+extern int32_t ece391_thread_create(int32_t (*func)(void*), void* arg, void* stack_top);
+extern int32_t ece391_thread_exit(int32_t status);
+extern int32_t ece391_thread_join(int32_t tid);
+extern int32_t ece391_futex_wait(volatile int32_t* addr, int32_t expected);
+extern int32_t ece391_futex_wake(volatile int32_t* addr, int32_t n);
+/* fds[0] reads what is written to fds[1]; execute also accepts "a | b" */
+extern int32_t ece391_pipe(int32_t* fds);
+extern int32_t ece391_isatty(int32_t fd);
+/* segments are named by key, attach at a page aligned address in
+   0x08000000-0x08400000 that is not in use yet */
+extern int32_t ece391_shm_create(int32_t key, uint32_t size);
+extern int32_t ece391_shm_attach(int32_t shm_id, void* addr);
+extern int32_t ece391_shm_detach(void* addr);
+/* spawn runs a command without waiting for it, waitpid collects it
+   (pid -1 for any child); with WNOHANG waitpid returns 0 if none halted */
+#define WNOHANG 1
+extern int32_t ece391_spawn(const uint8_t* command);
+extern int32_t ece391_waitpid(int32_t pid, int32_t* status, int32_t options);
+/* moves the end of the heap, returns the old end or (void*)-1 */
+extern void* ece391_sbrk(int32_t increment);
+/* dup returns the lowest free fd for the same open file, dup2 closes newfd
+   first; both fds then share the file position */
+extern int32_t ece391_dup(int32_t fd);
+extern int32_t ece391_dup2(int32_t oldfd, int32_t newfd);
+/* copies a regular file to out_fd inside the kernel, from *offset (moved
+   along) or from the file position of in_fd if offset is 0 */
+extern int32_t ece391_sendfile(int32_t out_fd, int32_t in_fd, int32_t* offset, int32_t count);
+/* regular files and the directory can seek, pread leaves the position */
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+extern int32_t ece391_lseek(int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_pread(int32_t fd, void* buf, int32_t nbytes, int32_t offset);
+/* calls enter the kernel with sysenter when the cpu has it, else int $0x80;
+   ece391_fast_syscall(0) forces int $0x80, returns 1 if sysenter is used */
+extern int32_t ece391_fast_syscall(int32_t enable);
+/* does nothing in the kernel, returns -1 */
+extern int32_t ece391_null(void);
+/* monotonic nanoseconds since boot from the TSC */
+extern int32_t ece391_gettime_ns(uint64_t* ns);
+/* block for ms milliseconds (in 10ms ticks) without spinning, -1 if a
+   signal cut it short */
+extern int32_t ece391_sleep_ms(int32_t ms);
+/* one ALARM signal after ms, 0 cancels; replaces the default 10s alarm and
+   returns the ms that were left on the old one */
+extern int32_t ece391_alarm(int32_t ms);
+/* interrupts taken per irq since boot, fills up to n counts (16 irqs) */
+extern int32_t ece391_irqstat(uint32_t* counts, int32_t n);
 
 enum signums {
 	DIV_ZERO = 0,
@@ -31,8 +80,17 @@ enum signums {
 	INTERRUPT,
 	ALARM,
 	USER1,
-	NUM_SIGNALS
+	CHILD,		/* a forked or spawned child exited */
+	NUM_SIGNALS = 32
 };
 
+/* sets of signals for ece391_sigprocmask, DIV_ZERO and SEGFAULT can not be
+   blocked */
+#define SIG_BIT(signum) (1U << (signum))
+#define SIG_BLOCK   0
+#define SIG_UNBLOCK 1
+#define SIG_SETMASK 2
+extern int32_t ece391_sigprocmask(int32_t how, const uint32_t* set, uint32_t* oldset);
+
 #endif /* ECE391SYSCALL_H */
 
@@ -1,6 +1,8 @@
 #if !defined(ECE391SYSNUM_H)
 #define ECE391SYSNUM_H
 
+/* rejected right away, only measures entering and leaving the kernel */
+#define SYS_NULL    0
 #define SYS_HALT    1
 #define SYS_EXECUTE 2
 #define SYS_READ    3
@@ -14,4 +16,28 @@
 #define SYS_BEEP    12
 #define SYS_PS      13
 #define SYS_RANDOM  14
+#define SYS_FORK    15
+#define SYS_THREAD_CREATE 16
+#define SYS_THREAD_EXIT   17
+#define SYS_THREAD_JOIN   18
+#define SYS_FUTEX_WAIT    19
+#define SYS_FUTEX_WAKE    20
+#define SYS_PIPE          21
+#define SYS_ISATTY        22
+#define SYS_SHM_CREATE    23
+#define SYS_SHM_ATTACH    24
+#define SYS_SHM_DETACH    25
+#define SYS_SPAWN         26
+#define SYS_WAITPID       27
+#define SYS_SBRK          28
+#define SYS_DUP           29
+#define SYS_DUP2          30
+#define SYS_SENDFILE      31
+#define SYS_LSEEK         32
+#define SYS_PREAD         33
+#define SYS_GETTIME_NS    34
+#define SYS_SLEEP_MS      35
+#define SYS_ALARM         36
+#define SYS_IRQSTAT       37
+#define SYS_SIGPROCMASK   38
 #endif /* ECE391SYSNUM_H */
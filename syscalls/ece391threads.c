@@ -0,0 +1,43 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE     32
+#define STACK_SIZE  4096
+
+static uint8_t worker_stack[STACK_SIZE];
+
+/* sums 1..n while the main thread waits on the keyboard */
+static int32_t worker (void* arg)
+{
+    int32_t n = (int32_t)arg;
+    int32_t i, sum = 0;
+
+    for (i = 1; i <= n; i++)
+        sum += i;
+    return sum;
+}
+
+int main ()
+{
+    int32_t tid, sum;
+    uint8_t buf[BUFSIZE];
+
+    tid = ece391_thread_create (worker, (void*)1000, worker_stack + STACK_SIZE);
+    if (-1 == tid) {
+        ece391_fdputs (1, (uint8_t*)"thread_create failed\n");
+        return 3;
+    }
+    ece391_fdputs (1, (uint8_t*)"Press enter to collect the worker: ");
+    ece391_read (0, buf, BUFSIZE-1);
+    if (-1 == (sum = ece391_thread_join (tid))) {
+        ece391_fdputs (1, (uint8_t*)"thread_join failed\n");
+        return 3;
+    }
+    ece391_fdputs (1, (uint8_t*)"sum of 1..1000 is ");
+    ece391_fdputs (1, ece391_itoa (sum, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    return 0;
+}